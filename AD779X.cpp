@@ -17,10 +17,10 @@
 
 /* _adcFlags byte
 * bit location * Description
-*			 7 * 
-*			 6 * 
-*			 5 * 
-*			 4 * 
+*			 7 * Calibration conversion running
+*			 6 * Config() pending
+*			 5 * Continuous conversion
+*			 4 * DOUT/~RDY interrupt
 *			 3 * CREAD
 *			 2 * Calibrate
 *			 1 * First measurement
@@ -31,7 +31,8 @@
  ************************************************************************************************************************
  * adcCommRegByte(MODE_REG, READ_REG)								function to create the byte for a Read operation to the Mode register
  * adcRead(ID_REG)													return the corresponding register value
- * adcWrite(unsigned char registerSelection, unsigned char val)		write the First and Second byte of the corresponding register
+ * adcWrite(unsigned char registerSelection, unsigned long val)		write the First and Second byte of the corresponding register
+ * adcQueueRead(DATA_REG) / adcTransfer()							queue register accesses and send them as one SPI block
  ************************************************************************************************************************
  */
  
@@ -56,96 +57,283 @@
 }
 
 unsigned long AD779X::adcRead(unsigned char registerSelection) {
-	unsigned long registerValue = 0;
-	unsigned char incomingByte = 0;
-	if (!(registerSelection == DATA_REG && adcFlag(CREAD))) {					// in CREAD there is no need to specify the Communication register for a read to Data register
-		unsigned char commReg = adcCommRegByte(registerSelection, READ_REG);
-		incomingByte = SPI.transfer(commReg);
+	if ((registerSelection == MODE_REG && (_shadowValid & SHADOW_MODE)) || (registerSelection == CONFIG_REG && (_shadowValid & SHADOW_CONFIG)) || (registerSelection == IO_REG && (_shadowValid & SHADOW_IO))) {
+		AD779X_COUNT(cachedReads, 1);									// the chip still holds what was last written
+		return registerSelection == MODE_REG ? _chipMode : registerSelection == CONFIG_REG ? _chipConfig : _chipIO;
 	}
-	else {
-		#if DEBUG_ADC
+	#if DEBUG_ADC
+		if (registerSelection == DATA_REG && adcFlag(CREAD)) {
 			Serial.println("ADC in CREAD mode");
-		#endif
+		}
+	#endif
+	unsigned char nBytes = adcRegBytes(registerSelection);
+	unsigned char at = adcQueueRead(registerSelection);
+	adcTransfer();
+	unsigned long registerValue = adcFrameValue(at, nBytes);
+	#if DEBUG_ADC
+		Serial.print("Reading a ");
+		Serial.print(nBytes * 8);
+		Serial.print("-bit Register: ");
+		Serial.println(registerValue, nBytes == 3 ? HEX : BIN);
+	#endif
+	return registerValue;
+}
+
+void AD779X::adcWrite(unsigned char registerSelection, unsigned long val) {	// write Mode Register and select Operating Mode OR write Offset/Full-Scale register value
+	if (registerSelection == CONFIG_REG || registerSelection == MODE_REG || registerSelection == IO_REG) {
+		adcStage(registerSelection, val);
+		adcFlush();
 	}
-	incomingByte = SPI.transfer(STUFFIN);
-	if (registerSelection == STATUS_REG || registerSelection == ID_REG || registerSelection == IO_REG) {		
-		registerValue = incomingByte;
-		#if DEBUG_ADC
-			Serial.print("Reading an 8-bit Register: ");
-			Serial.println(registerValue, BIN);
-		#endif		
-		return registerValue;
+	else if (registerSelection == OFFSET_REG || registerSelection == FULL_SCALE_REG) {	// write OFFSET or FULL-SCALE REGISTER (16-bits for AD7798 / 24-bits for AD7799)
+		adcQueueValue(registerSelection, val);
+		adcTransfer();
 	}
-	else {
-		#if DEBUG_ADC
-			Serial.print("First Byte: ");
-			Serial.print(incomingByte, BIN);
-		#endif
-		registerValue = incomingByte << 8; 		// store selected register FByte
-		incomingByte = SPI.transfer(STUFFIN);	// read selected register S(econd)Byte
-		#if DEBUG_ADC
-			Serial.print(" Second Byte: ");
-			Serial.print(incomingByte, BIN);
-		#endif
-		registerValue |= incomingByte;
-		if (registerSelection == MODE_REG || registerSelection == CONFIG_REG || (registerSelection == DATA_REG && !adcFlag(ADC_MODEL)) || (registerSelection == OFFSET_REG && !adcFlag(ADC_MODEL)) || (registerSelection == FULL_SCALE_REG && !adcFlag(ADC_MODEL))) {	
-			#if DEBUG_ADC
-				Serial.print(" Reading a 16-bit Register: ");
-				Serial.println(registerValue, BIN);
-			#endif			
-			return registerValue;
+	// delay(1);
+}
+
+/* SPI frames
+ *******************************************************************
+ * Register accesses are queued in _frame and clocked out by a single
+ * block SPI.transfer(), so the status read, the data read and the start
+ * of the next conversion cost one call in one CS-low window. Between
+ * adcSelect() and adcDeselect() the bus runs in a transaction with the
+ * library's own SPISettings, sketches no longer set mode and clock.
+ * The bus and the pins are reached through _port, the AD779X_TRANSPORT
+ * policy (AD779XTransport.h).
+ *******************************************************************
+ */
+
+void AD779X::adcSelect() {					// take the bus and select the device
+	#if AD779X_ASYNC
+		if (_engine) {
+			_engine->wait();					// blocking traffic only on an idle bus
 		}
-		else {
-			registerValue <<= 8;
-			incomingByte = SPI.transfer(STUFFIN);	// read selected register Third Byte
-			registerValue |= incomingByte;			// store 24-bit register value
-			registerValue &= 0xFFFFFF;
-			#if DEBUG_ADC
-				Serial.print(" Third Byte: ");
-				Serial.print(incomingByte, HEX);
-				Serial.print(" Read a 24-bit Register: ");
-				Serial.println(registerValue, HEX);
-			#endif				
-			return registerValue;
+	#endif
+	_port.beginTransaction();
+	_port.select();
+	#if AD779X_TRACE
+		if (_trace) {
+			_trace->select(true);
+		}
+	#endif
+}
+
+void AD779X::adcDeselect() {
+	_port.deselect();
+	#if AD779X_TRACE
+		if (_trace) {
+			_trace->select(false);
+		}
+	#endif
+	_port.endTransaction();
+}
+
+unsigned char AD779X::adcRegBytes(unsigned char registerSelection) {
+	if (registerSelection == STATUS_REG || registerSelection == ID_REG || registerSelection == IO_REG) {
+		return 1;
+	}
+	if (registerSelection == MODE_REG || registerSelection == CONFIG_REG) {
+		return 2;
+	}
+	return _nBytes;								// DATA, OFFSET and FULL-SCALE: 16-bits for AD7798 / 24-bits for AD7799
+}
+
+void AD779X::adcQueue(unsigned char val) {
+	if (_frameLength < AD779X_FRAME_SIZE) {
+		_frame[_frameLength++] = val;
+	}
+}
+
+void AD779X::adcQueueValue(unsigned char registerSelection, unsigned long val) {	// OFFSET or FULL-SCALE write, sent with the caller's adcTransfer()
+	adcQueue(adcCommRegByte(registerSelection, WRITE_REG));				// specify the communication register for a writing operation to the selected register	
+	for (int i = 0; i < _nBytes; i++) {
+		adcQueue((val >> 8*(_nBytes - i - 1)) & 0xFF);
+	}
+	AD779X_COUNT(writeBytes, 1 + _nBytes);
+}
+
+unsigned char AD779X::adcQueueRead(unsigned char registerSelection) {	// returns where the register value will be in _frame
+	if (!(registerSelection == DATA_REG && adcFlag(CREAD))) {					// in CREAD there is no need to specify the Communication register for a read to Data register
+		adcQueue(adcCommRegByte(registerSelection, READ_REG));
+	}
+	unsigned char at = _frameLength;
+	for (unsigned char i = adcRegBytes(registerSelection); i > 0; i--) {
+		adcQueue(STUFFIN);
+	}
+	#if AD779X_TELEMETRY
+		_frameReceived += _frameLength - at;
+	#endif
+	return at;
+}
+
+void AD779X::adcTransfer() {				// clock out the queued frame, what came back stays in _frame
+	adcFrameOut();
+	if (_frameLength) {
+		_port.transfer(_frame, _frameLength);
+	}
+	adcFrameIn();
+}
+
+void AD779X::adcFrameOut() {				// the queued frame goes on the bus, here or from an engine
+	#if AD779X_TRACE
+		if (_trace && _frameLength) {
+			_trace->sent(_frame, _frameLength);
+		}
+	#endif
+}
+
+void AD779X::adcFrameIn() {					// what came back is in _frame, the queue is empty again
+	#if AD779X_TRACE
+		if (_trace && _frameLength) {
+			_trace->received(_frame);
 		}
+	#endif
+	#if AD779X_TELEMETRY
+		_telemetry.spiSent += _frameLength - _frameReceived;
+		_telemetry.spiReceived += _frameReceived;
+		_frameReceived = 0;
+	#endif
+	_frameLength = 0;
+}
+
+unsigned long AD779X::adcFrameValue(unsigned char at, unsigned char nBytes) {
+	unsigned long registerValue = 0;
+	for (unsigned char i = 0; i < nBytes; i++) {
+		registerValue = registerValue << 8 | _frame[at + i];
 	}
+	return registerValue;
+}
+
+void AD779X::SPIClock(unsigned long clock) {	// SCLK in Hz, the parts take up to 5MHz (datasheet p.6)
+	_port.clock(clock);
 }
 
-void AD779X::adcWrite(unsigned char registerSelection, unsigned char val) {	// write Mode Register and select Operating Mode OR write Offset/Full-Scale register value
-	unsigned char commReg = adcCommRegByte(registerSelection, WRITE_REG);
-	unsigned char incomingByte = SPI.transfer(commReg);						// specify the communication register for a writing operation to the selected register	
+/* Register shadow
+ *******************************************************************
+ * _modeReg?Byte, _configReg?Byte and _ioReg hold the wanted values,
+ * _chipMode, _chipConfig and _chipIO the values last confirmed on the
+ * chip. adcStage() changes a wanted value, adcFlush() sends the staged
+ * registers that differ from the chip in one go, CONFIG and IO first so
+ * that MODE starts the operation on the final channel and range. MODE
+ * values that start a conversion or a calibration are commands and are
+ * always sent; the chip leaves those modes on its own, so the MODE
+ * shadow is not trusted after them.
+ *******************************************************************
+ */
+
+void AD779X::adcStage(unsigned char registerSelection, unsigned char val) {
 	if (registerSelection == CONFIG_REG) {
-		_configRegSByte = (_configRegSByte & CHANNEL_MASK) | val;
-		#if DEBUG_ADC
-			Serial.print("Writing Configuration Register FByte: ");
-			Serial.println(_configRegFByte, BIN);
-			Serial.print("Writing Configuration Register SByte: ");
-			Serial.println(_configRegSByte, BIN);			
-		#endif
-		incomingByte = SPI.transfer(_configRegFByte);						// write CONFIGURATION REGISTER FByte
-		incomingByte = SPI.transfer(_configRegSByte);						// write CONFIGURATION REGISTER SByte - val: Channel Select
+		_configRegSByte = (_configRegSByte & CHANNEL_MASK) | val;			// val: Channel Select
+		_shadowDirty |= SHADOW_CONFIG;
 	}
 	else if (registerSelection == MODE_REG) {
-		_modeRegFByte = (_modeRegFByte & OPERATING_MODE_MASK) | val;
-		#if DEBUG_ADC
-			Serial.print("Writing Mode Register FByte: ");
-			Serial.println(_modeRegFByte, BIN);
-			Serial.print("Writing Mode Register SByte: ");
-			Serial.println(_modeRegSByte, BIN);			
-		#endif
-		incomingByte = SPI.transfer(_modeRegFByte);							// write MODE REGISTER FByte - val: Operating Mode
-		incomingByte = SPI.transfer(_modeRegSByte);							// write MODE REGISTER SByte
+		_modeRegFByte = (_modeRegFByte & OPERATING_MODE_MASK) | val;		// val: Operating Mode
+		_shadowDirty |= SHADOW_MODE;
 	}
-	else if (registerSelection == IO_REG) {									// write IO REGISTER
-		incomingByte = SPI.transfer(val);
+	else if (registerSelection == IO_REG) {
+		_ioReg = val;
+		_shadowDirty |= SHADOW_IO;
 	}
-	else if (registerSelection == OFFSET_REG || registerSelection == FULL_SCALE_REG) {	// write OFFSET or FULL-SCALE REGISTER (16-bits for AD7798 / 24-bits for AD7799)
-		for (int i = 0; i < _nBytes; i++) {
-			incomingByte = SPI.transfer(val >> 8*(_nBytes - i - 1));
+}
+
+void AD779X::adcStageConfig(unsigned int config) {	// a complete CONFIG word, channel bits included
+	_configRegFByte = config >> 8;
+	_configRegSByte = config & 0xFF;
+	_shadowDirty |= SHADOW_CONFIG;
+}
+
+void AD779X::adcFlush() {
+	adcQueueWrites();
+	adcTransfer();
+}
+
+void AD779X::adcQueueWrites() {				// queue the staged registers that differ from the chip
+	if (_shadowDirty & SHADOW_CONFIG) {
+		unsigned int config = (unsigned int)_configRegFByte << 8 | _configRegSByte;
+		if (!(_shadowValid & SHADOW_CONFIG) || _chipConfig != config) {
+			#if DEBUG_ADC
+				Serial.print("Writing Configuration Register FByte: ");
+				Serial.println(_configRegFByte, BIN);
+				Serial.print("Writing Configuration Register SByte: ");
+				Serial.println(_configRegSByte, BIN);			
+			#endif
+			adcQueue(adcCommRegByte(CONFIG_REG, WRITE_REG));
+			adcQueue(_configRegFByte);										// write CONFIGURATION REGISTER FByte
+			adcQueue(_configRegSByte);										// write CONFIGURATION REGISTER SByte
+			_chipConfig = config;
+			_shadowValid |= SHADOW_CONFIG;
+			AD779X_COUNT(writeBytes, 3);
+		}
+		else {
+			AD779X_COUNT(savedBytes, 3);
 		}
 	}
-	// delay(1);
+	if (_shadowDirty & SHADOW_IO) {
+		if (!(_shadowValid & SHADOW_IO) || _chipIO != _ioReg) {
+			adcQueue(adcCommRegByte(IO_REG, WRITE_REG));
+			adcQueue(_ioReg);												// write IO REGISTER
+			_chipIO = _ioReg;
+			_shadowValid |= SHADOW_IO;
+			AD779X_COUNT(writeBytes, 2);
+		}
+		else {
+			AD779X_COUNT(savedBytes, 2);
+		}
+	}
+	if (_shadowDirty & SHADOW_MODE) {
+		unsigned int mode = (unsigned int)_modeRegFByte << 8 | _modeRegSByte;
+		unsigned char operatingMode = _modeRegFByte & ~OPERATING_MODE_MASK;
+		bool command = operatingMode == SNGL_CONV_MODE || operatingMode >= INT_ZERO_SCALE_CAL;
+		if (command || !(_shadowValid & SHADOW_MODE) || _chipMode != mode) {
+			#if DEBUG_ADC
+				Serial.print("Writing Mode Register FByte: ");
+				Serial.println(_modeRegFByte, BIN);
+				Serial.print("Writing Mode Register SByte: ");
+				Serial.println(_modeRegSByte, BIN);			
+			#endif
+			adcQueue(adcCommRegByte(MODE_REG, WRITE_REG));
+			adcQueue(_modeRegFByte);										// write MODE REGISTER FByte
+			adcQueue(_modeRegSByte);										// write MODE REGISTER SByte
+			_chipMode = mode;
+			AD779X_COUNT(writeBytes, 3);
+			if (command) {
+				_shadowValid &= ~SHADOW_MODE;
+			}
+			else {
+				_shadowValid |= SHADOW_MODE;
+			}
+		}
+		else {
+			AD779X_COUNT(savedBytes, 3);
+		}
+	}
+	_shadowDirty = 0;
+}
+
+void AD779X::setIO(unsigned char io) {		// IOEN, IO2DAT and IO1DAT, staged for the next register writes of a burst or step
+	noInterrupts();								// the ISR may be flushing the shadow
+	bool streaming = adcFlag(CREAD);
+	if (!streaming) {
+		adcStage(IO_REG, io & 0x70);
+	}
+	interrupts();
+	if (streaming) {							// nothing can be written into a CREAD stream: stop first, the restart writes it
+		adcStop();
+		adcStage(IO_REG, io & 0x70);
+	}
+}
+
+#if AD779X_TELEMETRY
+const AD779XTelemetry &AD779X::telemetry() {		// counters since the constructor or clearTelemetry(), read with the acquisition idle or from the ISR's side
+	return _telemetry;
+}
+
+void AD779X::clearTelemetry() {
+	noInterrupts();
+	memset(&_telemetry, 0, sizeof(_telemetry));
+	interrupts();
 }
+#endif
 
 void AD779X::adcFlag(unsigned char bit, unsigned char flag) {
 	if (bit == SET) {
@@ -173,6 +361,19 @@ bool AD779X::adcFlag(unsigned char flag) {
  *			configure each channel according the latest user inputs,
  * 			calibrate the channel and
  *			store gain
+ *
+ * Nothing here waits on the chip. Reset, stopping a running acquisition,
+ * configuration and calibration are steps run by adcStep() from Update():
+ *
+ *	AD779X_RESET		500us after the 32 ones, then model and presence
+ *	AD779X_STOP			leave CREAD on the next ~RDY, MODE back to idle
+ *	AD779X_CONFIG		apply the settings passed to Config()
+ *	AD779X_CALIBRATE	one scan slot at a time, ~RDY polled between calls
+ *	AD779X_RECOVER		after a fault reset, replay the registers and read them back
+ *	AD779X_READY		conversions run
+ *
+ * Each call does what it can without waiting and returns, State() and
+ * Progress() tell where it is.
  *******************************************************************
  */
  
@@ -180,14 +381,23 @@ void AD779X::adcReset() {						// write 32 ones to reset ADC
 	#if DEBUG_ADC
 		Serial.println("Reseting the ADC...");
 	#endif	
-	byte incomingByte = 0;
+	adcFlag(CLEAR, CREAD);
+	_chipMode = 0x000A;							// the chip is back to its defaults (datasheet p.14-16)
+	_chipConfig = 0x0710;
+	_chipIO = 0x00;
+	_shadowValid = SHADOW_MODE | SHADOW_CONFIG | SHADOW_IO;
+	_shadowDirty = SHADOW_CONFIG | SHADOW_IO;	// restored with the next flush, MODE with the next operation
 	for (int i = 0; i < 4; i++) {				// send 0xFFFFFFFF
-		incomingByte = SPI.transfer(RESET_ADC);
+		adcQueue(RESET_ADC);
 	}
-	delayMicroseconds(500);						// (datasheet --> p.23 ~p.19) wait 500us
-	#if DEBUG_ADC
-		Serial.println("ADC reset");
-	#endif	
+	adcTransfer();
+	AD779X_COUNT(resets, 1);
+	adcFlag(CLEAR, FIRST_MEASUREMENT);			// the chip is back in its default mode
+	adcFlag(CLEAR, CAL_WAIT);
+	_calIndex = 0;								// a pending calibration starts over
+	_calGain = 0;
+	_step = AD779X_RESET;						// (datasheet --> p.23 ~p.19) adcStep() waits 500us
+	_stepStart = micros();
 }
 
 void AD779X::adcResetVars() {
@@ -197,14 +407,31 @@ void AD779X::adcResetVars() {
 	_adcChannels = 3;			// ADC has 3 physical channels
 	_adcFlags = 0;				// reset the flags
 	_gain = 128;				// reinitialize gain
-	_settleTime = 120;			// reset settle time to default value
-	_numberOfChannels = 3;		// reset number of channels used to default value
+	adcRate(0x0A);				// chip default, 16.7Hz
+	_numberOfChannels = 3;		// reset number of scan slots used to default value
 	_channelIndex = 0;			// reset channel indexing
 	_configRegFByte = 0x07;		// default value of Configuration Register First Byte (datasheet p.16)
 	_configRegSByte = 0x10;		// default value of Configuration Register Second Byte (datasheet p.16)
 	_modeRegFByte = 0x40;		// default value of Mode Register First Byte (datasheet p.14)
 	_modeRegSByte = 0x0A;		// default value of Mode Register Second Byte (datasheet p.14)
 	_adcPresent = false;		// default value of chip present indicator
+	_nBytes = 3;				// until the model is read
+	_calMask = 0;				// no calibration pending
+	_calForce = false;
+	_calValid = 0;				// the chip holds its factory coefficients
+	_recover = false;
+	_faults = 0;
+	clearCalibration();			// coefficients belong to the chip on this CS pin
+	_sampleSeq = 0;				// no results yet
+	_passChannels = 0;
+	_generation = 0;
+	memset(&_snapshot, 0, sizeof(_snapshot));
+	for (int i = 0; i < 3; i++) {
+		_channelConfig[i] = 0x0710;		// Configuration Register default without the channel bits
+		_channelArray[i] = i;
+		_dataSeq[i] = 0;
+	}
+	adcSlots();
 }
 
 
@@ -213,9 +440,20 @@ void AD779X::adcResetVars() {
 		Serial.println("Start of Init()");
 	#endif
 	adcResetVars();						// reset variables to default state
-	adcReset();							// reset the device
+	adcReset();							// reset the device, adcStep() reads the model
+	#if DEBUG_ADC
+		Serial.println("End of Init()");
+	#endif
+}
 
-	if (adcRead(STATUS_REG) & 0x08) {	// store adc model
+void AD779X::adcDetect() {				// after the reset: model and presence from the status register
+	adcSelect();
+	unsigned char statusByte = adcRead(STATUS_REG);
+	adcDeselect();
+	#if DEBUG_ADC
+		Serial.println("ADC reset");
+	#endif	
+	if (statusByte & 0x08) {			// store adc model
 		#if DEBUG_ADC
 			Serial.println("ADC Model: AD7799");
 		#endif
@@ -226,11 +464,99 @@ void AD779X::adcResetVars() {
 		#if DEBUG_ADC
 			Serial.println("ADC Model: AD7798");
 		#endif	
-	_nBytes = 2;
+		adcFlag(CLEAR, ADC_MODEL);
+		_nBytes = 2;
 	}
+	_adcPresent = statusByte & 0x80;	// ~RDY is high after a reset
 	#if DEBUG_ADC
-		Serial.println("End of Init()");
+		if (!_adcPresent) {
+			Serial.println("NO CHIP PRESENT");
+		}
 	#endif
+	if (_model >= 0 && _model != adcFlag(ADC_MODEL)) {	// another part than the one the code was built for
+		#if DEBUG_ADC
+			Serial.println("ADC model does not match");
+		#endif
+		_adcPresent = false;
+	}
+	if (_calModel != 0xFF && _calModel != adcFlag(ADC_MODEL)) {	// loaded coefficients of another part
+		clearCalibration();
+	}
+	adcScale();
+}
+
+bool AD779X::adcStep() {				// run setup steps until one has to wait, true once conversions can run
+	while (_step != AD779X_READY) {
+		if (_step == AD779X_RESET) {
+			if (micros() - _stepStart < 500) {
+				return false;
+			}
+			adcDetect();
+		}
+		else if (_step == AD779X_STOP) {
+			if (!adcStopStep()) {
+				return false;
+			}
+		}
+		else if (_step == AD779X_CONFIG) {
+			adcConfigure();
+		}
+		else if (_step == AD779X_CALIBRATE) {
+			if (!adcCalStep()) {
+				return false;
+			}
+		}
+		else if (_step == AD779X_RECOVER) {
+			adcRecover();
+		}
+		_step = adcNextStep();
+		_stepStart = micros();
+	}
+	return true;
+}
+
+unsigned char AD779X::adcNextStep() {
+	if (!_adcPresent) {
+		return AD779X_READY;				// Update() returns false
+	}
+	if (adcFlag(FIRST_MEASUREMENT)) {
+		return AD779X_STOP;
+	}
+	if (_recover) {
+		return AD779X_RECOVER;
+	}
+	if (adcFlag(CONFIG_PENDING)) {
+		return AD779X_CONFIG;
+	}
+	if (_calMask) {
+		return AD779X_CALIBRATE;
+	}
+	return AD779X_READY;
+}
+
+void AD779X::adcSchedule() {			// pending work starts with the next Update()
+	if (_step == AD779X_READY) {
+		_step = adcNextStep();
+		_stepStart = micros();
+	}
+}
+
+unsigned char AD779X::State() {
+	return _step;
+}
+
+unsigned char AD779X::Progress() {		// percent of the running step
+	if (_step == AD779X_READY) {
+		return 100;
+	}
+	if (_step == AD779X_RESET) {
+		unsigned long elapsed = micros() - _stepStart;
+		return elapsed >= 500 ? 99 : elapsed / 5;
+	}
+	if (_step == AD779X_CALIBRATE && _numberOfChannels) {
+		return 100 * _calIndex / _numberOfChannels;
+	}
+	return 0;
 }
 
 /* Public Functions
@@ -238,56 +564,160 @@ void AD779X::adcResetVars() {
  * AD7799 myADC(2.5)						initalize a new library object with the name myADC
 											the applied vRef is 2.5V
  * myADC.Begin(2)							the device cs pin in number 2
+ * myADC.Begin(2, 3)						cs pin 2, DOUT/~RDY also wired to interrupt pin 3
  * myADC.Config(1, 2, 1, 1, 0, 0, 0, 0)		ADC and channel specific configuration
+ * myADC.ConfigChannel(1, 0, 1)				channel 1 only: gain 1, unipolar (buffer, burnout current)
+ * myADC.AutoRange(0, 1, 0, 7)				channel 0 picks its own gain from 1 to 128 as its signal moves
+ * myADC.readGain(0)						G2-G0 code the latest channel 0 result was converted with
+ * myADC.saveCalibration(blob, size)		calibration coefficients to a blob, loadCalibration(blob, size) back
  * myADC.readRaw(1)							read channel 1 and return raw value
  * myADC.readmV(2)							read channel 2 and return value in mV
+ * myADC.readuV(2)							same in uV, integer math only (readnV for nV)
+ * myADC.readSample(2, sample)				channel 2 with its micros() and status, returns its sample number
+ * myADC.snapshot(set)						every scanned channel from the last complete pass, safe against the ISR
+ * myADC.convert(raw, uV, n, 0)				n raw values of channel 0 to uV in one pass, or a ring batch
+ * myADC.setVRef(2.5)						change the reference, scales are recomputed
+ * myADC.Sequence(slots, 5)					scan table of up to AD779X_SLOTS channels, repeats allowed
+ * myADC.Schedule(4, 1)						table from weights: AIN1 4x as often as AIN2
+ * myADC.Continuous(1)						stream in continuous conversion mode (CREAD with one channel)
+ * myADC.Continuous(1, 0)					stream without CREAD, each result read with its status
+ * myADC.attachRing(&ring)					queue every sample, read them back with ring.drain(buf, n)
+ * myADC.attachFilter(0, &filter)			run filter on every channel 0 sample, outputs from filter.read()
+ * myADC.attachStats(0, &stats)				noise statistics of every channel 0 sample, stats.take(window) to read them
+ * myADC.attachTrace(&trace)				record every CS edge and SPI frame, stream it out with trace.drain(buf, n)
+ * myADC.attachEngine(&engine)				result bursts clocked by a DMA or interrupt engine, Update() returns at once
+ * myADC.due()								us until the next result is expected, used by AD779XBus
+ * myADC.setIO(0x40)						IO register, P1/P2 as analog inputs
+ * myADC.telemetry()							samples, not-ready checks, timeouts, ERR/NOREF, SPI bytes, latency histogram
+ * myADC.SPIClock(1000000)					SCLK used by the library's SPI transactions (4MHz)
+ * myADC.Calibrate(SYS_ZERO_SCALE_CAL)		calibrate every scan slot, run step by step from Update()
+ * myADC.State()							AD779X_READY once reset, configuration and calibration are done
+ * myADC.Progress()							percent of the running step
  **********************************************************************************************
  */
 AD779X::AD779X(float vRef) {
 	_vRef = vRef;
+	_samplesReady = 0;
+	_samplesSeen = 0;
+	_dataLastStatus = 0x80;						// ~RDY: no result yet
+	adcFail = 0;
+	_ring = 0;
+	_filter[0] = _filter[1] = _filter[2] = 0;
+	_stats[0] = _stats[1] = _stats[2] = 0;
+	_rangeChannels = 0;
+	_rangePending = 0;
+	_rangeRecal = 0;
+	_rangeRestart = false;
+	_cread = true;
+	_calSweep = 0;
+	_calGain = 0;
+	#if AD779X_TRACE
+		_trace = 0;
+	#endif
+	#if AD779X_ASYNC
+		_engine = 0;
+		_burstPending = false;
+	#endif
+	_ioReg = 0;
+	_shadowValid = 0;
+	_shadowDirty = 0;
+	#if AD779X_TELEMETRY
+		memset(&_telemetry, 0, sizeof(_telemetry));
+		_sampleStart = 0;
+		_frameReceived = 0;
+	#endif
+	_port.clock(AD779X_SPI_CLOCK);
+	_frameLength = 0;
+	memset(_scale, 0, sizeof(_scale));
+	_model = -1;							// any part, AD779XT sets its own
+	_step = AD779X_READY;
+	_adcPresent = false;
 }
 
-void AD779X::Begin(int csPin) {
+void AD779X::Begin(int csPin, int rdyPin) {
 	_csPin = csPin;							// store the CS pin
-	pinMode(_csPin, OUTPUT);				// set cs pin as output
+	_port.begin(_csPin);					// set cs pin as output
 	#if DEBUG_ADC
 		Serial.println("Start of Begin()");
 		Serial.print("ADC CS PIN: ");
 		Serial.println(_csPin);
 	#endif	
-	digitalWrite(_csPin, LOW);				// select the device
+	adcSelect();							// select the device
 	Init();
-	long statusByte = StatusReg();
-	if (!(statusByte & 0x80)) {
+	_rdyPin = MISO;							// DOUT/~RDY can always be polled on MISO while CS is low
+	if (rdyPin >= 0) {						// interrupt capable pin wired to DOUT/~RDY
+		for (int i = 0; i < AD779X_IRQ_SLOTS; i++) {
+			if (!_irqOwner[i] || _irqOwner[i] == this) {
+				_irqOwner[i] = this;
+				_irqSlot = i;
+				_rdyPin = rdyPin;
+				pinMode(_rdyPin, INPUT);
+				_port.usingInterrupt(digitalPinToInterrupt(_rdyPin));
+				adcFlag(SET, IRQ_MODE);
+				break;
+			}
+		}
 		#if DEBUG_ADC
-			Serial.println("NO CHIP PRESENT");
+			if (!adcFlag(IRQ_MODE)) {
+				Serial.println("No free interrupt slot, polling ~RDY");
+			}
 		#endif
 	}
-	else {
-		_adcPresent = true;
-	}
-	digitalWrite(_csPin, HIGH);				// deselect the device
+	_port.watch(_rdyPin);
+	adcDeselect();							// deselect the device, Update() finds the chip 500us later
 	#if DEBUG_ADC
 		Serial.println("End of Begin()");
 	#endif
 }
 
-unsigned char AD779X::StatusReg() {
+unsigned char AD779X::StatusReg() {			// while acquiring, the status read with the latest result (a CREAD one is rebuilt from DOUT/~RDY and the code); a register read only when stopped
+	if (adcFlag(FIRST_MEASUREMENT)) {			// a read would break into a stream or an armed interrupt
+		return _dataLastStatus;
+	}
 	unsigned char statusReg = adcRead(STATUS_REG);
 	return statusReg;
 }
 
 
 void AD779X::Setup(unsigned char numberOfChannels, unsigned char firstChannel, unsigned char secondChannel, unsigned char thirdChannel) {
-	_numberOfChannels = numberOfChannels;
 	unsigned char channelArray[3] = {firstChannel, secondChannel, thirdChannel};
-	for (int i = 0; i < _numberOfChannels; i++) {
-		_channelArray[i] = channelArray[i];
+	Sequence(channelArray, numberOfChannels > 3 ? 3 : numberOfChannels);
+}
+
+/* Scan table
+ *****************************************************************
+ * Update() converts the slots of the scan table in turn and starts
+ * over. A channel may take any number of slots, so it is sampled
+ * that much more often: {1, 1, 1, 1, 2} reads AIN2 4x as often as
+ * AIN3. Consecutive slots of the same channel need no register
+ * writes; in continuous mode they also skip the settling period of
+ * a channel change, one conversion period per result instead of two.
+ * Schedule() builds the table from weights and spreads each
+ * channel's slots evenly over the pass.
+ *****************************************************************
+ */
+
+bool AD779X::Sequence(const unsigned char *channels, unsigned char n) {
+	if (n == 0 || n > AD779X_SLOTS) {
+		return false;
+	}
+	for (unsigned char i = 0; i < n; i++) {
+		if (channels[i] > 2) {
+			return false;
+		}
+	}
+	adcStop();									// the running scan ends before its table changes
+	for (unsigned char i = 0; i < n; i++) {
+		_channelArray[i] = channels[i];
 	}
+	_numberOfChannels = n;
+	_channelIndex = 0;
+	_passChannels = 0;							// the next snapshot is a whole pass of the new table
+	adcSlots();
 	#if DEBUG_ADC
 		Serial.println("****************************");
 		Serial.println("ADC Setup");
-		Serial.print("Number of channels: ");
+		Serial.print("Number of slots: ");
 		Serial.print(_numberOfChannels);
 		Serial.print("\tSelected channels: ");
 		for (int i = 0; i < _numberOfChannels; i++) {
@@ -296,63 +726,68 @@ void AD779X::Setup(unsigned char numberOfChannels, unsigned char firstChannel, u
 		Serial.println("");
 		Serial.println("****************************");
 	#endif
+	return true;
+}
+
+bool AD779X::Schedule(unsigned char weight0, unsigned char weight1, unsigned char weight2) {
+	const unsigned char weight[3] = {weight0, weight1, weight2};
+	unsigned char total = 0;
+	for (unsigned char c = 0; c < 3; c++) {
+		if (weight[c] > AD779X_SLOTS) {
+			return false;
+		}
+		total += weight[c];
+	}
+	if (total == 0 || total > AD779X_SLOTS) {
+		return false;
+	}
+	unsigned char table[AD779X_SLOTS];
+	int credit[3] = {0, 0, 0};
+	for (unsigned char i = 0; i < total; i++) {	// smooth weighted round robin: the channel furthest behind its share goes next
+		unsigned char next = 0;
+		for (unsigned char c = 0; c < 3; c++) {
+			credit[c] += weight[c];
+			if (credit[c] > credit[next]) {
+				next = c;
+			}
+		}
+		credit[next] -= total;
+		table[i] = next;
+	}
+	return Sequence(table, total);
 }
 
 void AD779X::Config(unsigned char gain, unsigned char coding, unsigned char updateRate, unsigned char buffer, unsigned char refDet, unsigned char burnoutCurrent, unsigned char powerSwitch) {
-	unsigned char newConfigRegFByte = ((burnoutCurrent << 5) & 0x20) | ((coding << 4) & 0x10) | (gain) & 0x07;	// store values passed by user
-	unsigned char newConfigRegSByte = ((refDet << 5) & 0x20) | (buffer << 4) & 0x10;							// store values passed by user
-	unsigned char newModeRegFByte = (powerSwitch << 4) & 0x10;													// store values passed by user
-	unsigned char newModeRegSByte = updateRate & 0x0F;															// store values passed by user
+	_newConfigRegFByte = ((burnoutCurrent << 5) & 0x20) | ((coding << 4) & 0x10) | (gain) & 0x07;	// stored until adcConfigure() runs
+	_newConfigRegSByte = ((refDet << 5) & 0x20) | (buffer << 4) & 0x10;							// stored until adcConfigure() runs
+	_newModeRegFByte = (powerSwitch << 4) & 0x10;													// stored until adcConfigure() runs
+	_newModeRegSByte = updateRate & 0x0F;															// stored until adcConfigure() runs
+	for (int i = 0; i < 3; i++) {				// the same range on every channel, ConfigChannel() may change it before the step runs
+		_channelConfig[i] = (unsigned int)_newConfigRegFByte << 8 | _newConfigRegSByte;
+	}
+	adcSlots();
+	adcScale();
+	adcFlag(SET, CONFIG_PENDING);
+	adcStop();																									// registers can't be written while streaming or waiting on ~RDY
+}
+
+void AD779X::adcConfigure() {					// AD779X_CONFIG step: apply the last Config()
+	unsigned char gain = _newConfigRegFByte & 0x07;
+	unsigned char updateRate = _newModeRegSByte & 0x0F;
+	unsigned char newConfigRegFByte = _newConfigRegFByte;
+	unsigned char newConfigRegSByte = _newConfigRegSByte;
+	unsigned char newModeRegFByte = _newModeRegFByte;
+	unsigned char newModeRegSByte = _newModeRegSByte;
+	adcFlag(CLEAR, CONFIG_PENDING);
 	if (_adcPresent) {																							// chip is present
-		if (_modeRegSByte & 0x0F != updateRate) { 																// check if update rate has been changed
-			if (updateRate == 0x01) {
-			_settleTime = 4;
-			}
-			else if (updateRate == 0x02) {
-			_settleTime = 8;
-			}
-			else if (updateRate == 0x03) {
-			_settleTime = 16;
-			}
-			else if (updateRate == 0x04) {
-			_settleTime = 32;
-			}
-			else if (updateRate == 0x05) {
-			_settleTime = 40;
-			}
-			else if (updateRate == 0x06) {
-			_settleTime = 48;
-			}
-			else if (updateRate == 0x07) {
-			_settleTime = 60;
-			}
-			else if (updateRate == 0x08) {
-			_settleTime = 101;
-			}
-			else if (updateRate == 0x09 || updateRate == 0x0A) {
-			_settleTime = 120;
-			}
-			else if (updateRate == 0x0B) {
-			_settleTime = 160;
-			}
-			else if (updateRate == 0x0C) {
-			_settleTime = 200;
-			}
-			else if (updateRate == 0x0D) {
-			_settleTime = 240;
-			}
-			else if (updateRate == 0x0E) {
-			_settleTime = 320;
-			}
-			else if (updateRate == 0x0F) {
-			_settleTime = 480;
-			}
+		if ((_modeRegSByte & 0x0F) != updateRate) { 															// check if update rate has been changed
+			adcRate(updateRate);
 			#if DEBUG_ADC
-				Serial.print("New Update Rate. Settling time: ");
-				Serial.println(updateRate);
+				Serial.print("New Update Rate. Conversion period (us): ");
+				Serial.println(_periodNominal);
 			#endif
 		}
-		if (_configRegFByte & 0x07 != gain & 0x07) {									// in case the gain has been changed 
+		if ((_configRegFByte & 0x07) != (gain & 0x07)) {								// in case the gain has been changed 
 			_gain = 1 << gain;
 			#if DEBUG_ADC
 				Serial.print("Setting Gain: ");
@@ -362,14 +797,17 @@ void AD779X::Config(unsigned char gain, unsigned char coding, unsigned char upda
 				adcFlag(SET, CALIBRATE);												// raise the calibration flag if needed
 			}
 		}
+		if (((_configRegSByte ^ newConfigRegSByte) & 0x10) && gain != 0x07) {		// the buffer changes the range as much as the gain does
+			adcFlag(SET, CALIBRATE);
+		}
 		if (adcFlag(CALIBRATE)) {					// if calibration is needed
 			_configRegFByte = newConfigRegFByte;	// store new Configuration Register FByte
 			_configRegSByte = newConfigRegSByte;	// store new Configuration Register SByte
 			_modeRegFByte = newModeRegFByte;		// store new Mode Register FByte
 			_modeRegSByte = newModeRegSByte;		// store new Mode Register	SByte
-			digitalWrite(_csPin, LOW);				// select the device
+			adcSelect();							// select the device
 			adcCalibrate(INT_FULL_SCALE_CAL);		// select each channel and calibrate
-			digitalWrite(_csPin, HIGH);				// deselect the device
+			adcDeselect();							// deselect the device
 			adcFlag(CLEAR, CALIBRATE);				// clear calibration flag
 		}
 		else {										// in case no calibration is needed check
@@ -381,13 +819,97 @@ void AD779X::Config(unsigned char gain, unsigned char coding, unsigned char upda
 				_configRegSByte = newConfigRegSByte;
 				_modeRegFByte = newModeRegFByte;
 				_modeRegSByte = newModeRegSByte;
-				digitalWrite(_csPin, LOW);			// select the device
-				adcWrite(CONFIG_REG, 0x00);
-				adcWrite(MODE_REG, IDLE_MODE);			
-				digitalWrite(_csPin, HIGH);			// deselect the device
+				adcSelect();						// select the device
+				adcStageConfig(_slotConfig[0]);
+				adcStage(MODE_REG, IDLE_MODE);
+				adcFlush();
+				adcDeselect();						// deselect the device
 			}
 		}		
+		adcScale();									// gain and coding may have changed
+	}
+}
+
+void AD779X::ConfigChannel(unsigned char channel, unsigned char gain, unsigned char coding, unsigned char buffer, unsigned char burnoutCurrent) {
+	if (channel > 2) {
+		return;
+	}
+	unsigned int previous = _channelConfig[channel];
+	_channelConfig[channel] = (unsigned int)(((burnoutCurrent << 5) & 0x20) | ((coding << 4) & 0x10) | (gain & 0x07)) << 8 | (_channelConfig[channel] & 0x20) | ((buffer << 4) & 0x10);
+	if (_channelConfig[channel] == previous) {
+		return;
+	}
+	adcSlots();
+	adcScale();
+	if ((previous ^ _channelConfig[channel]) & 0x0710) {	// new range: gain or buffer, both part of the calibration key
+		if ((_rangeChannels & (1 << channel)) && ((previous ^ _channelConfig[channel]) & 0x10)) {
+			_calSweep |= 1 << channel;			// an auto-ranged channel needs its whole range with the new BUF
+		}
+		adcCalibrate(INT_FULL_SCALE_CAL, 1 << channel);	// cached coefficients are restored, gain 128 keeps the factory ones if none are
+		adcStop();
+	}
+}
+
+bool AD779X::AutoRange(unsigned char channel, unsigned char enable, unsigned char lowestGain, unsigned char highestGain) {	// gain of a physical channel follows its signal, between two G2-G0 codes; false if the cache can't hold the ranges
+	if (channel > 2 || lowestGain > highestGain || highestGain > 0x07) {
+		return false;
+	}
+	unsigned char entries = enable ? highestGain - lowestGain + 1 : 0;
+	for (unsigned char i = 0; i < 3; i++) {
+		if (i != channel && (_rangeChannels & (1 << i))) {
+			entries += (_rangeLimits[i] >> 4) - (_rangeLimits[i] & 0x0F) + 1;
+		}
+	}
+	if (entries > AD779X_CAL_ENTRIES) {			// every gain of every range stays cached
+		return false;
+	}
+	noInterrupts();
+	_rangeLimits[channel] = lowestGain | highestGain << 4;
+	_rangePending &= ~(1 << channel);
+	if (enable) {
+		_rangeChannels |= 1 << channel;
+	}
+	else {
+		_rangeChannels &= ~(1 << channel);
+	}
+	interrupts();
+	if (enable) {								// coefficients of every gain of the range, measured once
+		_calSweep |= 1 << channel;
+		adcCalibrate(INT_FULL_SCALE_CAL, 1 << channel);
+		adcStop();
+	}
+	return true;
+}
+
+void AD779X::adcSlots() {						// CONFIG word of every scan slot, built once so a conversion start is a plain copy
+	for (int i = 0; i < _numberOfChannels; i++) {
+		_slotConfig[i] = _channelConfig[_channelArray[i]] | _channelArray[i];
+	}
+	_slotRepeats = 0;
+	_slotChanges = 0;
+	_scanChannels = 0;
+	for (unsigned char i = 0; i < _numberOfChannels; i++) {
+		_scanChannels |= 1 << _channelArray[i];
+		if (_slotConfig[i] == _slotConfig[i ? i - 1 : _numberOfChannels - 1]) {	// the table wraps around
+			_slotRepeats |= 1U << i;
+		}
+		else {
+			_slotChanges++;
+		}
+	}
+}
+
+bool AD779X::adcSlotFirst(unsigned char slot) {	// first slot of its channel, the one calibrated and replayed
+	for (unsigned char i = 0; i < slot; i++) {
+		if (_channelArray[i] == _channelArray[slot]) {
+			return false;
+		}
 	}
+	return true;
+}
+
+unsigned char AD779X::adcSlotPeriods() {		// conversion periods until the running slot's result
+	return adcFlag(CONTINUOUS) && (_slotRepeats >> _channelIndex & 1) ? 1 : 2;	// a CONFIG write restarts the filter
 }
 
 // void AD779X::adcCheck() {
@@ -403,7 +925,7 @@ void AD779X::Config(unsigned char gain, unsigned char coding, unsigned char upda
 	// Serial.println(_modeRegFByte << 8 | _modeRegSByte, BIN);
 // }
 
-void AD779X::adcCalibrate(unsigned char calibrationMode) {
+void AD779X::adcCalibrate(unsigned char calibrationMode, unsigned char channelMask) {	// every scan slot whose channel bit is set in channelMask, run by adcStep()
     #if DEBUG_ADC
     if (calibrationMode == INT_ZERO_SCALE_CAL) {
 		Serial.println("Starting Internal Zero-Scale Calibration...");
@@ -421,125 +943,1041 @@ void AD779X::adcCalibrate(unsigned char calibrationMode) {
 		Serial.println("Invalid Calibration Mode");
 	}
     #endif
-	for (int i = 0; i < _numberOfChannels; i++) {
-		adcWrite(CONFIG_REG, i);
-		adcWrite(MODE_REG, calibrationMode);
-		#if DEBUG_ADC
-			Serial.print("Calibration of channel ");
-			Serial.print(_channelArray[i]);
-			Serial.println(" in progress");
-		
-			while((adcRead(STATUS_REG) >> 7)) {
-				Serial.println(".");
+	_calMode = calibrationMode;
+	_calMask |= channelMask;
+	_calIndex = 0;
+	_calGain = 0;
+	adcFlag(CLEAR, CAL_WAIT);
+}
+
+bool AD779X::Calibrate(unsigned char calibrationMode, unsigned char channelMask) {	// e.g. SYS_ZERO_SCALE_CAL with the inputs shorted, false while another one is pending
+	if (_calMask || calibrationMode < INT_ZERO_SCALE_CAL) {
+		return false;
+	}
+	_calForce = true;							// measure even if the range is cached
+	adcCalibrate(calibrationMode, channelMask);
+	adcStop();
+	return true;
+}
+
+bool AD779X::adcCalStep() {					// AD779X_CALIBRATE step, true once every slot on _calMask is done
+	if (adcFlag(CAL_WAIT)) {
+		unsigned char channel = _channelArray[_calIndex];
+		adcSelect();
+		if (_port.busy()) {							// ~RDY falls once the coefficients are in place
+			adcDeselect();
+			if (micros() - _stepStart > 4*adcExpected(2)) {	// two conversion periods, with a 4x margin
+				adcFlag(CLEAR, CAL_WAIT);
+				adcFail++;
+				AD779X_COUNT(timeouts, 1);
 			}
+			return false;
+		}
+		_offsetReg[channel] = adcRead(OFFSET_REG);
+		_fullScaleReg[channel] = adcRead(FULL_SCALE_REG);
+		_calValid |= 1 << channel;
+		adcDeselect();
+		adcCalStore(adcCalKey(_calConfig), _offsetReg[channel], _fullScaleReg[channel]);
+		#if DEBUG_ADC
 			Serial.print("Channel ");
-			Serial.print(_channelArray[i]);
+			Serial.print(channel);
 			Serial.println( " calibrated.");
 		#endif
+		adcFlag(CLEAR, CAL_WAIT);
 	}
-	 #if DEBUG_ADC
-		Serial.println("End of Calibration...");
-    #endif
-}
-
-bool AD779X::Update() {
-	if (_adcPresent) {
-		if (!adcFlag(FIRST_MEASUREMENT)) {
+	while (_calIndex < _numberOfChannels) {
+		unsigned char channel = _channelArray[_calIndex];
+		if (!(_calMask & (1 << channel)) || !adcSlotFirst(_calIndex) || _calGain > 8) {
+			adcCalNext();
+			continue;
+		}
+		unsigned int config = _slotConfig[_calIndex];
+		unsigned char step = _calGain++;
+		if (step < 8 && !(_calSweep & (1 << channel))) {
+			step = 8;							// not auto-ranged: its own range only
+			_calGain = 9;
+		}
+		if (step < 8) {							// steps 0-7: gains 128, 1, 2 ... 64 of an auto-ranged channel, for its switches
+			unsigned char gain = (step + 7) & 0x07;	// 128 first, while the chip may still hold its factory coefficients
+			if (gain < (_rangeLimits[channel] & 0x0F) || gain > _rangeLimits[channel] >> 4 || (gain == (config >> 8 & 0x07) && gain != 0x07)) {
+				continue;
+			}
+			config = (config & 0xF8FF) | (unsigned int)gain << 8;
+			if (!_calForce && adcCalFind(adcCalKey(config))) {
+				continue;
+			}
+		}										// step 8: the slot's own range, what the chip keeps
+		bool factory = _calMode == INT_FULL_SCALE_CAL && (config >> 8 & 0x07) == 0x07;	// no internal full-scale calibration at gain 128
+		AD779XCalEntry *entry = _calForce && !factory ? 0 : adcCalFind(adcCalKey(config));
+		if (factory && (step < 8 || !entry)) {	// the chip's gain 128 coefficients are the factory ones, as long as nothing wrote over them
+			if (!entry && (_calSweep & (1 << channel)) && !(_calValid & (1 << channel))) {
+				adcSelect();
+				adcStageConfig(config);
+				adcFlush();
+				unsigned long offset = adcRead(OFFSET_REG);
+				adcCalStore(adcCalKey(config), offset, adcRead(FULL_SCALE_REG));
+				adcDeselect();
+			}
+			continue;
+		}
+		adcSelect();
+		adcStageConfig(config);					// calibrate at the slot's own gain, or one of its range
+		if (entry) {							// coefficients known for this channel and range: a write instead of two conversion periods
+			adcFlush();
+			adcWrite(OFFSET_REG, entry->offset);
+			adcWrite(FULL_SCALE_REG, entry->fullScale);
+			adcDeselect();
+			_offsetReg[channel] = entry->offset;
+			_fullScaleReg[channel] = entry->fullScale;
+			_calValid |= 1 << channel;
+			#if DEBUG_ADC
+				Serial.print("Channel ");
+				Serial.print(channel);
+				Serial.println(" restored from the calibration cache");
+			#endif
+			continue;
+		}
+		adcStage(MODE_REG, _calMode);
+		adcFlush();
+		adcDeselect();
+		AD779X_COUNT(calibrations, 1);
+		#if DEBUG_ADC
+			Serial.print("Calibration of channel ");
+			Serial.print(channel);
+			Serial.println(" in progress");
+		#endif
+		_calConfig = config;
+		adcFlag(SET, CAL_WAIT);
+		_stepStart = micros();
+		return false;
+	}
+	#if DEBUG_ADC
+		Serial.println("End of Calibration...");
+	#endif
+	_calMask = 0;
+	_calSweep = 0;
+	_calForce = false;
+	return true;
+}
+
+void AD779X::adcCalNext() {					// the slot at _calIndex is done
+	_calIndex++;
+	_calGain = 0;
+}
+
+/* Calibration cache
+ *******************************************************************
+ * OFFSET and FULL-SCALE read back after each calibration, keyed by
+ * channel, gain and buffer. A cached range is restored with two register
+ * writes instead of recalibrating; saveCalibration()/loadCalibration()
+ * move the cache to and from EEPROM or a file.
+ *
+ * Blob: 'A' '7' model count, count x (key, offset, full-scale; 3 bytes
+ * each, MSB first), checksum (two's complement of the byte sum)
+ *******************************************************************
+ */
+
+unsigned char AD779X::adcCalKey(unsigned int config) {	// valid bit, BUF, CH2-CH0, G2-G0
+	return 0x80 | (config & 0x10) << 2 | (config & 0x07) << 3 | ((config >> 8) & 0x07);
+}
+
+AD779XCalEntry *AD779X::adcCalFind(unsigned char key) {
+	for (int i = 0; i < AD779X_CAL_ENTRIES; i++) {
+		if (_cal[i].key == key) {
+			return &_cal[i];
+		}
+	}
+	return 0;
+}
+
+bool AD779X::adcCalPinned(unsigned char key) {	// a gain of an auto-ranged channel's range, at its BUF setting
+	unsigned char channel = key >> 3 & 0x07, gain = key & 0x07;
+	return channel < 3 && (_rangeChannels & (1 << channel)) && gain >= (_rangeLimits[channel] & 0x0F) && gain <= _rangeLimits[channel] >> 4 && !((key ^ adcCalKey(_channelConfig[channel])) & 0x40);
+}
+
+void AD779X::adcCalStore(unsigned char key, unsigned long offset, unsigned long fullScale) {
+	AD779XCalEntry *entry = adcCalFind(key);
+	for (int i = 0; !entry && i < AD779X_CAL_ENTRIES; i++) {	// oldest entry goes first, auto-range entries stay
+		if (!_cal[_calNext].key || !adcCalPinned(_cal[_calNext].key)) {
+			entry = &_cal[_calNext];
+		}
+		_calNext = (_calNext + 1) % AD779X_CAL_ENTRIES;
+	}
+	if (!entry) {
+		return;									// all pinned, the chip still holds the coefficients
+	}
+	entry->key = key;
+	entry->offset = offset;
+	entry->fullScale = fullScale;
+}
+
+void AD779X::clearCalibration() {				// the next range change calibrates again
+	memset(_cal, 0, sizeof(_cal));
+	_calNext = 0;
+	_calModel = 0xFF;
+}
+
+unsigned int AD779X::saveCalibration(unsigned char *blob, unsigned int size) {	// bytes used, 0 if size is too small
+	unsigned char count = 0;
+	for (int i = 0; i < AD779X_CAL_ENTRIES; i++) {
+		if (_cal[i].key) {
+			count++;
+		}
+	}
+	unsigned int length = 5 + 7 * count;
+	if (size < length) {
+		return 0;
+	}
+	unsigned int n = 0;
+	blob[n++] = 'A';
+	blob[n++] = '7';
+	blob[n++] = adcFlag(ADC_MODEL);
+	blob[n++] = count;
+	for (int i = 0; i < AD779X_CAL_ENTRIES; i++) {
+		if (!_cal[i].key) {
+			continue;
+		}
+		blob[n++] = _cal[i].key;
+		for (int b = 2; b >= 0; b--) {
+			blob[n++] = _cal[i].offset >> 8*b;
+		}
+		for (int b = 2; b >= 0; b--) {
+			blob[n++] = _cal[i].fullScale >> 8*b;
+		}
+	}
+	unsigned char sum = 0;
+	for (unsigned int i = 0; i < n; i++) {
+		sum += blob[i];
+	}
+	blob[n++] = -sum;
+	return n;
+}
+
+bool AD779X::loadCalibration(const unsigned char *blob, unsigned int size) {	// after Begin(), before Config()
+	if (size < 5 || blob[0] != 'A' || blob[1] != '7' || (_step != AD779X_RESET && blob[2] != adcFlag(ADC_MODEL)) || blob[3] > AD779X_CAL_ENTRIES || size < 5 + 7 * (unsigned int)blob[3]) {
+		return false;							// not a blob, another part or too short
+	}
+	unsigned int length = 5 + 7 * blob[3];
+	unsigned char sum = 0;
+	for (unsigned int i = 0; i < length; i++) {
+		sum += blob[i];
+	}
+	if (sum) {
+		return false;
+	}
+	clearCalibration();
+	_calModel = blob[2];						// checked again once the model is read
+	for (unsigned int i = 4; i + 1 < length; i += 7) {
+		unsigned long offset = (unsigned long)blob[i + 1] << 16 | (unsigned long)blob[i + 2] << 8 | blob[i + 3];
+		unsigned long fullScale = (unsigned long)blob[i + 4] << 16 | (unsigned long)blob[i + 5] << 8 | blob[i + 6];
+		adcCalStore(blob[i] | 0x80, offset, fullScale);
+	}
+	return true;
+}
+
+bool AD779X::Update() {								// register widths picked at runtime from the detected model
+	if (_step != AD779X_READY && !adcStep()) {
+		return false;									// reset, configuration or calibration still running
+	}
+	return _nBytes == 3 ? updateT<3>() : updateT<2>();
+}
+
+template <unsigned char NBytes>
+bool AD779X::updateT() {								// NBytes: DATA register width, 2 for AD7798 / 3 for AD7799
+	if (_rangeRecal) {
+		adcRangeRecalibrate();							// the next calls run the calibration
+		return false;
+	}
+	if (_adcPresent) {
+		if (adcFlag(IRQ_MODE)) {
+			return irqUpdate();
+		}
+		if (!adcFlag(FIRST_MEASUREMENT)) {
 			adcFlag(SET, FIRST_MEASUREMENT);
 			#if DEBUG_ADC
 				Serial.println("Starting first measurement");
 			#endif
-			digitalWrite(_csPin, LOW);
-			startConversion(_channelIndex);
-			digitalWrite(_csPin, HIGH);
-			_previousMillis = millis();	// start the clock for first time
+			adcSelect();
+			if (adcFlag(CONTINUOUS)) {
+				startStream();
+			}
+			else {
+				startConversion(_channelIndex);
+				adcTransfer();
+			}
+			adcDeselect();
+			adcPlan(2);					// start the clock for first time
 			return false;
 		}
 		else {
-			unsigned long timePassed = millis() - _previousMillis;	// store time passed since last check
+			#if AD779X_ASYNC
+				if (_engine) {
+					if (_samplesReady != _samplesSeen) {			// a burst finished since the last call
+						_samplesSeen = _samplesReady;
+						return true;
+					}
+					if (_burstPending || !_engine->idle()) {		// MISO is busy, DOUT/~RDY cannot be seen
+						return false;
+					}
+				}
+			#endif
+			if ((long)(micros() - _pollAt) < 0) {					// predicted completion not reached yet
+				return false;
+			}
+			unsigned long timePassed = micros() - _conversionStart;
 			#if DEBUG_ADC
-				Serial.print("Settle Time: ");
-				Serial.println(_settleTime);
+				Serial.print("Time Passed(us): ");
+				Serial.println(timePassed);
 			#endif
-			if (timePassed >= _settleTime) {						// if settle time has passed				
+			adcSelect();
+			unsigned char statusByte = adcDoutStatus();				// DOUT/~RDY first, it costs no SPI bytes
+			if (statusByte >> 7) {									// and no data available yet
 				#if DEBUG_ADC
-					Serial.print("Time Passed(ms): ");
-					Serial.println(timePassed);
+					Serial.println("No data available yet.");
 				#endif
-				digitalWrite(_csPin, LOW);
-				unsigned long statusByte = adcRead(STATUS_REG);
-				if (statusByte >> 7) {								// and no data available yet
+				adcDeselect();										// deselect the device
+				if (timePassed > adcExpected(_periods + 4)) {		// then if it is four periods late
 					#if DEBUG_ADC
-						Serial.println("No data available yet.");
+						Serial.print("Timeout (us): ");
+						Serial.println(timePassed);
 					#endif
-					if (timePassed > 4*_settleTime) {				// then if it takes too long
-						#if DEBUG_ADC
-							Serial.print("Timeout (ms): ");
-							Serial.println(timePassed);
-						#endif
-						adcReset();									// reset the device
-						Config(_configRegFByte & 0x07, 
-							   _configRegFByte & 0x10, 
-							   _modeRegSByte & 0x0F, 
-							   _configRegSByte & 0x10, 
-							   _configRegSByte & 0x20, 
-							   _configRegFByte & 0x0F, 
-							   _modeRegFByte & 0x10);				// reconfigure the ADC according the last user settings
-						adcFail++;									// and store a failed attempt
-					}
-					digitalWrite(_csPin, HIGH);						// deselect the device
-					return false;
+					adcTimeout();									// reset and reconfigure the device
 				}
-				else {  											// else get data, start the measurement of the next channel and reset the clock
-					if (statusByte & 0x40) {
-						#if DEBUG_ADC
-							Serial.print("Warning!! Channel ");
-							Serial.print(_channelArray[_channelIndex]);
-							Serial.println(" Overrange or Underrange");
-						#endif
-					}
-					#if DEBUG_ADC
-						Serial.println("DATA READY!!");
-						Serial.print("Writing data for channel ");
-						Serial.println(_channelArray[_channelIndex], DEC);
-					#endif
-					_dataRaw[_channelArray[_channelIndex]] = adcRead(DATA_REG);
-					#if DEBUG_ADC
-						Serial.print("Channel ");
-						Serial.print(_channelArray[_channelIndex], DEC);
-						Serial.print(" Raw Value: ");
-						Serial.println(_dataRaw[_channelArray[_channelIndex]], HEX);
-					#endif				
-					_channelIndex = _channelIndex++ >= (_numberOfChannels - 1)  ? 0 : _channelIndex++;
-					startConversion(_channelIndex);
-					digitalWrite(_csPin, HIGH);
-					_previousMillis = millis();
-					return true;
+				else {
+					AD779X_COUNT(notReady, 1);
+					_pollMisses++;
+					_pollAt = micros() + (_period >> 10);			// early, look again shortly
 				}
+				return false;
 			}
-			else {
-				#if DEBUG_ADC
-					Serial.println("Time passed < Settle time.");
+			else {  												// else get data, start the measurement of the next channel and reset the clock
+				adcLearn(micros(), false);
+				#if AD779X_ASYNC
+					if (_engine) {									// the engine clocks the burst, adcBurstDone() stores it
+						adcBurstT<NBytes>(statusByte);
+						adcSubmit(0);								// still selected from the DOUT/~RDY check
+						return false;
+					}
 				#endif
-				return false;
+				adcSampleT<NBytes>(statusByte);						// status, data and next conversion in one burst
+				adcDeselect();
+				adcPlan(adcSlotPeriods());
+				return true;
 			}
 		}
 	}
+	return false;
 }
 
-void AD779X::startConversion(unsigned char channel) {
+void AD779X::adcSample(unsigned char statusByte) {
+	if (_nBytes == 3) {
+		adcSampleT<3>(statusByte);
+	}
+	else {
+		adcSampleT<2>(statusByte);
+	}
+}
+
+template <unsigned char NBytes>
+void AD779X::adcSampleT(unsigned char statusByte) {	// one burst: status, data and the start of the next conversion
+	adcBurstT<NBytes>(statusByte);
+	adcTransfer();
+	adcStoreT<NBytes>();
+}
+
+template <unsigned char NBytes>
+void AD779X::adcBurstT(unsigned char statusByte) {	// queue the reads of the finished slot and the start of the next one
+	_burstSlot = _channelIndex;
+	_burstStatus = statusByte;
+	_burstGain = _chipConfig >> 8 & 0x07;				// the range the finished conversion ran with
+	_rangeRestart = false;
+	#if DEBUG_ADC
+		Serial.println("DATA READY!!");
+		Serial.print("Writing data for channel ");
+		Serial.println(_channelArray[_burstSlot], DEC);
+	#endif
+	_burstStatusAt = 0;
+	if (!adcFlag(CREAD)) {								// streaming only shifts data out
+		_burstStatusAt = adcQueueRead(STATUS_REG);			// ERR and NOREF of the finished conversion
+		adcQueue(adcCommRegByte(DATA_REG, READ_REG));
+	}
+	_burstDataAt = _frameLength;
+	for (unsigned char i = 0; i < NBytes; i++) {			// fixed trip count, unrolled
+		adcQueue(STUFFIN);
+	}
+	#if AD779X_TELEMETRY
+		_frameReceived += NBytes;
+	#endif
+	if (_rangePending) {
+		adcRangeQueue();								// before the next conversion starts
+	}
+	_channelIndex = _channelIndex + 1 < _numberOfChannels ? _channelIndex + 1 : 0;
+	startConversion(_channelIndex);						// queued behind the reads
+	if (_rangeRestart && adcFlag(CONTINUOUS) && _slotChanges == 0 && _cread) {
+		adcFlag(SET, CREAD);							// back to streaming the data bytes only
+		adcQueue(ENTER_CREAD);
+	}
+}
+
+template <unsigned char NBytes>
+void AD779X::adcStoreT() {							// the burst came back: the sample goes to the store, ring and filter
+	unsigned char slot = _burstSlot;
+	unsigned char channel = _channelArray[slot];
+	unsigned char statusByte = _burstStatusAt ? _frame[_burstStatusAt] : _burstStatus;	// CREAD reads no status
+	unsigned long dataRaw = 0;
+	for (unsigned char i = 0; i < NBytes; i++) {
+		dataRaw = dataRaw << 8 | _frame[_burstDataAt + i];
+	}
+	if (!_burstStatusAt && (dataRaw == 0 || dataRaw == (1UL << 8*NBytes) - 1)) {	// no status read in CREAD, a clipped code means ERR
+		statusByte |= 0x40;
+	}
+	if (statusByte & 0x40) {
+		#if DEBUG_ADC
+			Serial.print("Warning!! Channel ");
+			Serial.print(channel);
+			Serial.println(" Overrange or Underrange");
+		#endif
+	}
+	if (_burstGain != _dataGain[channel]) {
+		adcRescale(channel, _burstGain);					// the scale goes with the code it converts
+	}
+	unsigned long now = micros();
+	_dataRaw[channel] = dataRaw;
+	_dataTime[channel] = now;
+	_dataStatus[channel] = statusByte;
+	_dataLastStatus = statusByte;
+	_dataSeq[channel] = ++_sampleSeq;
+	_passChannels |= 1 << channel;
+	if (slot == _numberOfChannels - 1) {					// last slot of the table, the pass is complete
+		if (_passChannels == _scanChannels) {
+			adcPublish();
+		}
+		_passChannels = 0;
+	}
+	_faults = 0;											// converting again, the next fault starts a new escalation
+	#if AD779X_TELEMETRY
+		_telemetry.samples[channel]++;
+		if (statusByte & 0x40) {
+			_telemetry.errors++;
+		}
+		if (statusByte & 0x20) {
+			_telemetry.noRef++;
+		}
+		unsigned long latency = micros() - _sampleStart;
+		unsigned char bin = 0;
+		while (latency && bin < AD779X_LATENCY_BINS - 1) {
+			latency >>= 1;
+			bin++;
+		}
+		_telemetry.latency[bin]++;
+	#endif
+	if (_ring) {											// keep every sample, not just the latest per channel
+		AD779XSample sample = {now, dataRaw, channel, statusByte, _burstGain};
+		_ring->push(sample);
+	}
+	if (_filter[channel]) {									// every sample, filtered outputs come from the filter
+		_filter[channel]->push(dataRaw);
+	}
+	if (_stats[channel]) {
+		_stats[channel]->push(dataRaw);
+	}
+	if (_rangeChannels & (1 << channel)) {
+		adcRangeCheck(channel, dataRaw, statusByte);
+	}
+	#if DEBUG_ADC
+		Serial.print("Channel ");
+		Serial.print(channel, DEC);
+		Serial.print(" Raw Value: ");
+		Serial.println(_dataRaw[channel], HEX);
+	#endif				
+}
+
+/* Auto-ranging
+ *******************************************************************
+ * An auto-ranged channel picks its gain from each of its results. A
+ * clipped result (ERR) drops it to the lowest gain of its range, a
+ * result using more than 7/8 of the range drops it one step, and it
+ * rises while the result stays under 3/4 of the range after the step.
+ * The 1/8 in between keeps a steady signal from switching back and
+ * forth. The switch goes into the channel's next result burst, ahead
+ * of the next conversion start: CONFIG at the new gain and the
+ * OFFSET/FULL-SCALE coefficients cached for it, written in idle mode.
+ * No conversion is dropped and nothing is recalibrated; AutoRange()
+ * measures the coefficients of every gain of the range once, and only
+ * gains with cached coefficients are used: the cache needs an entry per
+ * gain of each range, 8 for one channel from 1 to 128 (the default
+ * AD779X_CAL_ENTRIES), 24 for three. AutoRange() refuses ranges the
+ * cache can't hold, and their entries are never evicted. Should the
+ * lowest gain still be missing (a failed calibration, a new BUF) a
+ * clipped channel switches to it anyway: Update() stops, calibrates it
+ * and starts over rather than leave it clipped. Each result carries the gain
+ * it was converted with, and _scale follows the code in _dataRaw, so
+ * readmV() and convert() stay continuous across a switch.
+ *******************************************************************
+ */
+
+void AD779X::adcRangeCheck(unsigned char channel, unsigned long raw, unsigned char statusByte) {	// gain for the channel's next conversions
+	unsigned char gain = _dataGain[channel];
+	unsigned int config = _channelConfig[channel];
+	if ((_rangePending & (1 << channel)) || gain != (config >> 8 & 0x07)) {
+		return;										// a switch is on its way
+	}
+	bool bipolar = !(config & 0x1000);
+	unsigned long full = 1UL << (8*_nBytes - bipolar);	// codes from 0V to the end of the range
+	unsigned long level = !bipolar ? raw : raw >= full ? raw - full : full - raw;
+	unsigned char lowest = _rangeLimits[channel] & 0x0F, highest = _rangeLimits[channel] >> 4;
+	unsigned char target = gain;
+	if ((statusByte & 0x40) && (bipolar || raw)) {	// clipped, by how much is unknown (unipolar 0 is an underrange)
+		target = lowest;
+		if (target < gain && !adcCalFind(adcCalKey((config & 0xF8FF) | (unsigned int)target << 8 | channel))) {
+			_rangeRecal |= 1 << channel;			// no coefficients to switch with, Update() recalibrates
+			return;
+		}
+	}
+	else if (level > full - (full >> 3)) {
+		target = gain ? gain - 1 : 0;
+	}
+	else {
+		while (target < highest && level << (target + 1 - gain) < full - (full >> 2)) {
+			target++;
+		}
+	}
+	target = target < lowest ? lowest : target > highest ? highest : target;
+	while (target != gain && !adcCalFind(adcCalKey((config & 0xF8FF) | (unsigned int)target << 8 | channel))) {
+		target += target > gain ? -1 : 1;			// the nearest gain with cached coefficients
+	}
+	if (target != gain) {
+		_rangeGain[channel] = target;
+		_rangePending |= 1 << channel;
+	}
+}
+
+void AD779X::adcRangeQueue() {						// one pending switch into the burst being queued
+	unsigned char channel = _rangePending & 0x01 ? 0 : _rangePending & 0x02 ? 1 : 2;
+	_rangePending &= ~(1 << channel);
+	unsigned int config = (_channelConfig[channel] & 0xF8FF) | (unsigned int)_rangeGain[channel] << 8;
+	AD779XCalEntry *entry = adcCalFind(adcCalKey(config | channel));
+	if (!entry) {
+		return;
+	}
+	if (adcFlag(CREAD)) {							// the exit command is the first byte of this data read
+		_frame[_burstDataAt] = EXIT_CREAD;
+		adcFlag(CLEAR, CREAD);
+	}
+	if (adcFlag(CONTINUOUS)) {
+		adcStage(MODE_REG, IDLE_MODE);				// coefficients are written with the modulator stopped
+		adcQueueWrites();
+	}
+	adcStageConfig(config | channel);				// they go to the selected channel
+	adcQueueWrites();
+	adcQueueValue(OFFSET_REG, entry->offset);
+	adcQueueValue(FULL_SCALE_REG, entry->fullScale);
+	if (adcFlag(CONTINUOUS)) {
+		adcStage(MODE_REG, CONT_CONV_MODE);			// restarted by the next slot's writes
+	}
+	_channelConfig[channel] = config;
+	_offsetReg[channel] = entry->offset;
+	_fullScaleReg[channel] = entry->fullScale;
+	_calValid |= 1 << channel;
+	adcSlots();
+	_rangeRestart = true;
+	AD779X_COUNT(rangeChanges, 1);
+}
+
+void AD779X::adcRangeRecalibrate() {				// clipped channels without coefficients for their lowest gain: switch and measure
+	noInterrupts();
+	unsigned char channels = _rangeRecal & _rangeChannels;
+	_rangeRecal = 0;
+	_rangePending &= ~channels;
+	interrupts();
+	if (!channels) {
+		return;
+	}
+	for (unsigned char channel = 0; channel < 3; channel++) {
+		if (channels & (1 << channel)) {
+			_channelConfig[channel] = (_channelConfig[channel] & 0xF8FF) | (unsigned int)(_rangeLimits[channel] & 0x0F) << 8;
+		}
+	}
+	adcSlots();
+	adcScale();
+	_calSweep |= channels;						// the rest of the range too, cached gains are skipped
+	adcCalibrate(INT_FULL_SCALE_CAL, channels);
+	adcStop();
+}
+
+unsigned char AD779X::readGain(unsigned char channel) {	// G2-G0 code of the latest result of a channel
+	return channel < 3 ? _dataGain[channel] : 0;
+}
+
+/* Snapshots
+ *******************************************************************
+ * At the end of every scan pass the latest result of each scanned
+ * channel, its sample number and its time are copied to _snapshot.
+ * snapshot() reads it as a seqlock: _generation is odd while the copy
+ * is written, and a reader that saw it odd or changed reads again, so
+ * the loop never gets a set torn by the ISR and the ISR never waits.
+ *******************************************************************
+ */
+
+void AD779X::adcPublish() {
+	_generation++;
+	AD779X_BARRIER();
+	_snapshot.pass++;
+	_snapshot.channels = _scanChannels;
+	for (unsigned char i = 0; i < 3; i++) {
+		bool scanned = _scanChannels & (1 << i);
+		_snapshot.seq[i] = scanned ? _dataSeq[i] : 0;
+		_snapshot.timestamp[i] = scanned ? _dataTime[i] : 0;
+		_snapshot.raw[i] = scanned ? _dataRaw[i] : 0;
+		_snapshot.status[i] = scanned ? _dataStatus[i] : 0;
+		_snapshot.gain[i] = scanned ? _dataGain[i] : 0;
+	}
+	AD779X_BARRIER();
+	_generation++;
+}
+
+bool AD779X::snapshot(AD779XSnapshot &snapshot) {	// last complete scan pass, false before the first one
+	unsigned char generation;
+	do {
+		generation = _generation;
+		AD779X_BARRIER();
+		snapshot = _snapshot;
+		AD779X_BARRIER();
+	} while ((generation & 1) || generation != _generation);
+	return snapshot.pass != 0;
+}
+
+template bool AD779X::updateT<2>();					// used by AD779XT<AD7798, ...>
+template bool AD779X::updateT<3>();					// used by AD779XT<AD7799, ...>
+
+/* Fault recovery
+ *******************************************************************
+ * A conversion that never completes is a fault. The chip is reset and,
+ * once its 500us are over, every scan slot's CONFIG, the IO register,
+ * the OFFSET/FULL-SCALE coefficients on the chip before the fault and
+ * MODE are written back, one burst per slot, each read back in the
+ * same burst. Nothing is recalibrated, so conversions resume after the
+ * reset, the replay and one conversion. Repeated faults escalate:
+ *
+ *	1st		replay
+ *	2nd		replay, then measure every slot's calibration again
+ *	3rd on	as the 2nd, with the calibration cache dropped
+ *
+ * A replay that does not read back escalates to the 2nd level at once.
+ * The count starts over with the next good sample.
+ *******************************************************************
+ */
+
+void AD779X::adcTimeout() {
+	#if DEBUG_ADC
+		Serial.println("Conversion timeout");
+	#endif
+	if (adcFlag(FIRST_MEASUREMENT) && adcFlag(IRQ_MODE)) {
+		detachInterrupt(digitalPinToInterrupt(_rdyPin));
+	}
+	adcSelect();
+	adcReset();									// reset the device, this also ends CREAD
+	adcDeselect();
+	adcFail++;									// and store a failed attempt
+	AD779X_COUNT(timeouts, 1);
+	if (_faults < 0xFF) {
+		_faults++;
+	}
+	if (_faults > 2) {
+		clearCalibration();
+	}
+	if (_faults > 1) {
+		_calForce = true;
+		_calSweep = _rangeChannels;				// the other gains of auto-ranged channels too
+		adcCalibrate(INT_FULL_SCALE_CAL);
+	}
+	_recover = true;							// Update() replays the registers, then starts over
+}
+
+bool AD779X::adcRecover() {						// AD779X_RECOVER step, true if the chip read back what was written
+	bool verified = true;
+	_recover = false;
+	adcSelect();
+	for (unsigned char i = 0; i < _numberOfChannels; i++) {
+		if (!adcSlotFirst(i)) {
+			continue;
+		}
+		unsigned char channel = _channelArray[i];
+		bool restore = _calValid & (1 << channel);
+		adcStageConfig(_slotConfig[i]);
+		adcQueueWrites();						// CONFIG, IO with the first slot
+		if (restore) {
+			adcQueueValue(OFFSET_REG, _offsetReg[channel]);
+			adcQueueValue(FULL_SCALE_REG, _fullScaleReg[channel]);
+		}
+		unsigned char configAt = adcQueueRead(CONFIG_REG);	// from the chip, not the shadow
+		unsigned char offsetAt = restore ? adcQueueRead(OFFSET_REG) : 0;
+		unsigned char fullScaleAt = restore ? adcQueueRead(FULL_SCALE_REG) : 0;
+		adcTransfer();
+		if (adcFrameValue(configAt, 2) != _slotConfig[i] || (restore && (adcFrameValue(offsetAt, _nBytes) != _offsetReg[channel] || adcFrameValue(fullScaleAt, _nBytes) != _fullScaleReg[channel]))) {
+			verified = false;
+		}
+	}
+	adcStage(MODE_REG, IDLE_MODE);				// update rate and PSW, conversions start from Update()
+	adcQueueWrites();
+	unsigned char modeAt = adcQueueRead(MODE_REG);
+	adcTransfer();
+	adcDeselect();
+	if (adcFrameValue(modeAt, 2) != ((unsigned int)_modeRegFByte << 8 | _modeRegSByte)) {
+		verified = false;
+	}
+	AD779X_COUNT(recoveries, 1);
+	if (!verified) {
+		#if DEBUG_ADC
+			Serial.println("Register replay did not read back");
+		#endif
+		AD779X_COUNT(recoveryFailures, 1);
+		if (_faults < 2) {
+			_faults = 2;
+		}
+		_calForce = true;
+		adcCalibrate(INT_FULL_SCALE_CAL);
+	}
+	return verified;
+}
+
+/* Conversion timing
+ *******************************************************************
+ * The datasheet period of each update rate is only the starting point:
+ * the internal clock of a given chip runs a few percent off. Each read
+ * refines _period from the time ~RDY was seen low. An interrupt sees the
+ * exact edge. A poll that finds the result after a miss brackets it; a
+ * stream measures that over every period since the last bracket. A
+ * result found on the first poll only says the guess was late, so the
+ * estimate is trimmed, harder each time, until a poll misses again.
+ * Polls land at the predicted completion instead of every loop pass,
+ * and the timeout follows the learned period. A conversion takes two
+ * periods after a start or a channel change, one when a single channel
+ * streams.
+ *******************************************************************
+ */
+
+static const unsigned int adcPeriodTable[16] = {	// conversion period in 4us units per FS3-FS0 code, datasheet p.15 (code 0 is reserved)
+	532, 532, 1033, 2033, 4032, 5000, 6410, 7530, 12755, 14970, 14970, 20000, 25000, 30012, 40000, 59952
+};
+
+void AD779X::adcRate(unsigned char updateRate) {
+	_periodNominal = 4UL*adcPeriodTable[updateRate & 0x0F];
+	_period = _periodNominal;
+	_periods = 2;
+	_pollHits = 0;
+}
+
+unsigned long AD779X::adcExpected(unsigned char periods) {	// us, learned
+	return periods*_period;
+}
+
+void AD779X::adcPlan(unsigned char periods) {	// a conversion started now, or 1: a stream goes on
+	if (periods == 1 && _periods < 64) {
+		_periods++;								// one period later than the last, from the same anchor
+	}
+	else {
+		_periods = periods;
+		_conversionStart = micros();
+	}
+	_pollAt = _conversionStart + adcExpected(_periods);
+	_pollMisses = 0;
+	#if AD779X_TELEMETRY
+		_sampleStart = _pollAt - adcExpected(periods);	// when streaming, the previous result
+	#endif
+}
+
+void AD779X::adcLearn(unsigned long now, bool exact) {	// a result seen at now
+	unsigned long period = (now - _conversionStart) / _periods;
+	if (exact || _pollMisses) {					// the edge, or done between the last miss and now
+		if (exact || _periods <= 2) {
+			_period = _period - (_period >> 2) + (period >> 2);
+		}
+		else {									// many periods since the anchor, the error is spread over them
+			_period = period;
+		}
+		_conversionStart = now;					// a stream counts its periods from here
+		_periods = 0;
+		_pollHits = 0;
+	}
+	else {										// done some time before the poll: probe earlier, faster each time
+		_period -= _period >> (12 - (_pollHits < 8 ? _pollHits : 8));
+		_pollHits++;
+	}
+	if (_period < _periodNominal - (_periodNominal >> 3)) {		// stay within 12% of the datasheet
+		_period = _periodNominal - (_periodNominal >> 3);
+	}
+	else if (_period > _periodNominal + (_periodNominal >> 3)) {
+		_period = _periodNominal + (_periodNominal >> 3);
+	}
+}
+
+long AD779X::due() {								// us until the running conversion should be done, negative once overdue
+	if (_step != AD779X_READY) {
+		return 0;										// a setup step may be able to move on
+	}
+	if (!_adcPresent || adcFlag(IRQ_MODE)) {
+		return 0x7FFFFFFFL;
+	}
+	#if AD779X_ASYNC
+		if (_engine && _samplesReady != _samplesSeen) {
+			return 0;									// a burst finished, Update() reports it
+		}
+	#endif
+	if (!adcFlag(FIRST_MEASUREMENT)) {
+		return -0x7FFFFFFFL;
+	}
+	return (long)(_pollAt - micros());
+}
+
+unsigned char AD779X::adcDoutStatus() {			// while streaming DOUT/~RDY stands in for the status register
+	return (_port.busy() ? 0x80 : 0x00) | (adcFlag(ADC_MODEL) ? 0x08 : 0x00) | (_configRegSByte & 0x07);
+}
+
+void AD779X::adcStop() {						// end a running acquisition, adcStep() stops the chip and Update() starts over
+	if (adcFlag(FIRST_MEASUREMENT) && adcFlag(IRQ_MODE)) {
+		detachInterrupt(digitalPinToInterrupt(_rdyPin));
+	}
+	adcSchedule();
+}
+
+bool AD779X::adcStopStep() {					// AD779X_STOP step
+	adcSelect();
+	if (adcFlag(CREAD)) {
+		if (_port.busy()) {							// CREAD can only be left during a data read
+			adcDeselect();
+			if (micros() - _stepStart > 2*adcExpected(2)) {
+				adcTimeout();					// no result coming, a reset ends CREAD too
+			}
+			return false;
+		}
+		cRead(_channelArray[_channelIndex], 0);
+	}
+	adcWrite(MODE_REG, IDLE_MODE);
+	adcDeselect();
+	adcFlag(CLEAR, FIRST_MEASUREMENT);
+	return true;
+}
+
+/* Interrupt driven acquisition
+ *******************************************************************
+ * With a DOUT/~RDY capable pin passed to Begin(), CS is held low between
+ * conversions and a falling edge on the pin reads the result and starts
+ * the next channel straight from the ISR. DOUT/~RDY only signals while
+ * CS is low, so the chip needs the bus to itself while waiting; the SPI
+ * transaction is only held while the ISR clocks its burst.
+ *******************************************************************
+ */
+
+AD779X *AD779X::_irqOwner[AD779X_IRQ_SLOTS];
+
+void AD779X::adcIsr0() {
+	_irqOwner[0]->adcIsr();
+}
+
+void AD779X::adcIsr1() {
+	_irqOwner[1]->adcIsr();
+}
+
+void AD779X::adcArm() {						// release the bus, keep the device selected and wait for DOUT/~RDY to fall
+	_port.endTransaction();
+	attachInterrupt(digitalPinToInterrupt(_rdyPin), _irqSlot ? adcIsr1 : adcIsr0, FALLING);
+}
+
+void AD779X::adcIsr() {
+	if (_port.busy()) {								// edge left by shifting data or a latched flag
+		return;
+	}
+	#if AD779X_ASYNC
+		if (_burstPending) {					// edges of the burst the engine is clocking
+			return;
+		}
+	#endif
+	adcLearn(micros(), true);					// the edge is the end of the conversion
+	#if AD779X_ASYNC
+		if (_engine) {
+			unsigned char statusByte = adcDoutStatus();
+			if (_nBytes == 3) {
+				adcBurstT<3>(statusByte);
+			}
+			else {
+				adcBurstT<2>(statusByte);
+			}
+			adcSubmit(adcBurstBegin);			// CS is still low, the transaction starts with the transfer
+			return;
+		}
+	#endif
+	_port.beginTransaction();					// CS is still low from adcArm()
+	adcSample(adcDoutStatus());
+	_port.endTransaction();
+	adcPlan(adcSlotPeriods());
+	_samplesReady++;
+}
+
+bool AD779X::irqUpdate() {
+	if (!adcFlag(FIRST_MEASUREMENT)) {
+		adcFlag(SET, FIRST_MEASUREMENT);
+		adcSelect();
+		if (adcFlag(CONTINUOUS)) {
+			startStream();
+		}
+		else {
+			startConversion(_channelIndex);
+			adcTransfer();
+		}
+		adcPlan(2);
+		_samplesSeen = _samplesReady;
+		adcArm();								// CS stays low until the result is read
+		return false;
+	}
+	noInterrupts();
+	unsigned char samplesReady = _samplesReady;
+	unsigned long timePassed = micros() - _conversionStart;
+	unsigned long timeout = adcExpected(_periods + 4);
+	interrupts();
+	if (samplesReady != _samplesSeen) {
+		_samplesSeen = samplesReady;
+		return true;
+	}
+	if (timePassed > timeout) {
+		adcTimeout();							// start over on the next call
+	}
+	return false;
+}
+
+/* Asynchronous bursts
+ *******************************************************************
+ * With an AD779XEngine attached, the burst that reads a result and
+ * starts the next conversion is handed to the engine instead of being
+ * clocked here. Polled, the chip stays selected from the DOUT/~RDY check
+ * until adcBurstDone(); on the interrupt the bus transaction is taken
+ * when the engine gets to the burst. adcBurstDone() runs from the
+ * engine's interrupt and does what the blocking path does after
+ * adcTransfer(). Nothing else touches _frame meanwhile: adcSelect()
+ * waits for the engine first.
+ *******************************************************************
+ */
+
+#if AD779X_ASYNC
+void AD779X::attachEngine(AD779XEngine *engine) {	// engine for the result bursts, 0 to clock them here again
+	if (_engine) {
+		_engine->wait();
+	}
+	noInterrupts();
+	_engine = engine;
+	interrupts();
+}
+
+void AD779X::adcSubmit(void (*begin)(AD779XTransfer &transfer)) {
+	_transfer.frame = _frame;
+	_transfer.length = _frameLength;
+	_transfer.begin = begin;
+	_transfer.done = adcBurstDone;
+	_transfer.context = this;
+	_burstPending = true;
+	if (!begin) {
+		adcFrameOut();
+	}
+	if (!_engine->submit(&_transfer)) {				// full: clock it here after all
+		if (begin) {
+			begin(_transfer);
+		}
+		_port.transfer(_frame, _frameLength);
+		adcBurstDone();
+	}
+}
+
+void AD779X::adcBurstBegin(AD779XTransfer &transfer) {
+	AD779X *adc = (AD779X *)transfer.context;
+	adc->_port.beginTransaction();
+	adc->adcFrameOut();
+}
+
+void AD779X::adcBurstDone(AD779XTransfer &transfer) {
+	((AD779X *)transfer.context)->adcBurstDone();
+}
+
+void AD779X::adcBurstDone() {
+	adcFrameIn();
+	if (_nBytes == 3) {
+		adcStoreT<3>();
+	}
+	else {
+		adcStoreT<2>();
+	}
+	if (adcFlag(IRQ_MODE)) {
+		_port.endTransaction();					// CS stays low for the next edge
+	}
+	else {
+		adcDeselect();
+	}
+	adcPlan(adcSlotPeriods());
+	_burstPending = false;
+	_samplesReady++;
+}
+#endif
+
+void AD779X::startConversion(unsigned char channel) {	// queued, sent with the caller's adcTransfer()
 	#if DEBUG_ADC
 		Serial.print("Starting Conversion of channel: ");
 		Serial.println(_channelArray[channel], DEC);
 	#endif
-	channel = _channelArray[channel];
-	adcWrite(MODE_REG, SNGL_CONV_MODE);		// select Conversion Mode
-	adcWrite(CONFIG_REG, channel);			// select Channel
+	adcStageConfig(_slotConfig[channel]);	// the slot's channel, gain, coding and buffer, sent only if it differs
+	if (adcFlag(CONTINUOUS)) {				// the chip keeps converting, only a scan has to move on
+		adcQueueWrites();
+		return;
+	}
+	adcStage(MODE_REG, SNGL_CONV_MODE);		// select Conversion Mode
+	adcQueueWrites();						// one write each, the conversion starts on the new channel
+}
+
+void AD779X::startStream() {
+	unsigned char channel = _channelArray[_channelIndex];
+	#if DEBUG_ADC
+		Serial.print("Streaming from channel: ");
+		Serial.println(channel, DEC);
+	#endif
+	adcStageConfig(_slotConfig[_channelIndex]);	// select Channel
+	adcStage(MODE_REG, CONT_CONV_MODE);		// and keep converting it
+	adcFlush();
+	if (_slotChanges == 0 && _cread) {		// one channel only, each result is just the data bytes
+		cRead(channel, 1);
+	}
+}
+
+bool AD779XStreamable(unsigned char) __attribute__((weak));
+bool AD779XStreamable(unsigned char) {		// a board whose DOUT/~RDY can only be seen through SPI overrides this
+	return true;
+}
+
+bool AD779X::Continuous(unsigned char enable, unsigned char cread) {	// false if CREAD was asked for but DOUT/~RDY can't be watched, the results are then read with their status
+	_cread = cread && AD779XStreamable(_csPin);
+	adcFlag(enable ? SET : CLEAR, CONTINUOUS);
+	adcStop();
+	return !enable || !cread || _cread;
+}
+
+unsigned long AD779X::readSample(unsigned char channel, AD779XSample &sample) {	// latest result with its time and status, returns its sample number, 0 if none yet
+	if (channel >= _adcChannels) {
+		return 0;
+	}
+	noInterrupts();
+	sample.timestamp = _dataTime[channel];
+	sample.raw = _dataRaw[channel];
+	sample.status = _dataStatus[channel];
+	sample.gain = _dataGain[channel];
+	unsigned long seq = _dataSeq[channel];
+	interrupts();
+	sample.channel = channel;
+	return seq;
 }
 
 unsigned long AD779X::readRaw(unsigned char channel) {
-	if (channel < _numberOfChannels) {	
-		return _dataRaw[channel];
+	if (channel < _adcChannels) {		// any physical channel, whatever its slots
+		noInterrupts();					// the ISR may be writing the value
+		unsigned long dataRaw = _dataRaw[channel];
+		interrupts();
+		return dataRaw;
 	}
 	else {
 		#if DEBUG_ADC
@@ -549,38 +1987,194 @@ unsigned long AD779X::readRaw(unsigned char channel) {
 	}	
 }
 
+void AD779X::attachRing(AD779XRing *ring) {	// ring to receive each sample as it is read, 0 to detach
+	noInterrupts();
+	_ring = ring;
+	interrupts();
+}
+
+void AD779X::attachFilter(unsigned char channel, AD779XFilter *filter) {	// filter run on each sample of a physical channel, 0 to detach
+	if (channel > 2) {
+		return;
+	}
+	noInterrupts();
+	_filter[channel] = filter;
+	interrupts();
+}
+
+void AD779X::attachStats(unsigned char channel, AD779XStats *stats) {	// statistics of each sample of a physical channel, 0 to detach
+	if (channel > 2) {
+		return;
+	}
+	if (stats) {
+		stats->scale(_scale[channel].mV * 1000, 8*_nBytes);	// before it sees a sample
+	}
+	noInterrupts();
+	_stats[channel] = stats;
+	interrupts();
+}
+
+#if AD779X_TRACE
+void AD779X::attachTrace(AD779XTrace *trace) {	// trace to record the bus traffic from now on, 0 to detach
+	if (trace) {
+		trace->start(_csPin);					// CS pin and time base for the reader
+	}
+	noInterrupts();
+	_trace = trace;
+	interrupts();
+}
+#endif
+
 float AD779X::readmV(unsigned char channel) {
-	if (_configRegFByte & 0x10) {																			// Unipolar Mode
-		if (adcFlag(ADC_MODEL)) {																			// AD7799
-			_datamV[channel] = (float)(_dataRaw[channel])*0.000000059604644775390625*_vRef/_gain*1000;		// datasheet p.23
-		}
-		else {																								// AD7798
-			_datamV[channel] = (float)(_dataRaw[channel])*0.0000152587890625*_vRef/_gain*1000;				// datasheet p.23
-		}
+	noInterrupts();
+	unsigned long dataRaw = _dataRaw[channel];
+	float mV = _scale[channel].mV;				// with the code: auto-ranging changes both
+	interrupts();
+	return (float)((long)dataRaw - _scale[channel].zero) * mV;
+}
+
+long AD779X::readuV(unsigned char channel) {	// integer only, no float on the read path
+	noInterrupts();
+	unsigned long dataRaw = _dataRaw[channel];
+	unsigned long whole = _scale[channel].uV, frac = _scale[channel].uVFrac;
+	interrupts();
+	return adcFixed(dataRaw, _scale[channel].zero, whole, frac);
+}
+
+long AD779X::readnV(unsigned char channel) {	// fits a long up to +-2.147V, i.e. vRef/gain below that
+	noInterrupts();
+	unsigned long dataRaw = _dataRaw[channel];
+	unsigned long whole = _scale[channel].nV, frac = _scale[channel].nVFrac;
+	interrupts();
+	return adcFixed(dataRaw, _scale[channel].zero, whole, frac);
+}
+
+void AD779X::convert(const unsigned long *raw, long *uV, unsigned int n, unsigned char channel) {	// one channel, e.g. a block of readRaw() values
+	const long zero = _scale[channel].zero;
+	const unsigned long whole = _scale[channel].uV;
+	const unsigned long frac = _scale[channel].uVFrac;
+	for (unsigned int i = 0; i < n; i++) {		// no branches, the compiler can vectorize it on the host
+		uV[i] = adcFixed(raw[i], zero, whole, frac);
 	}
-	else { 																									// Bipolar
-		if (adcFlag(ADC_MODEL)) {																			// AD7799
-			_datamV[channel] = ((float)(_dataRaw[channel])*0.00000011920928955078125 - 1)*_vRef/_gain*1000;	// datasheet p.23
-		}
-		else {																								// AD7798
-			_datamV[channel] = ((float)(_dataRaw[channel])*0.000030517578125 - 1)*_vRef/_gain*1000;			// datasheet p.23
+}
+
+void AD779X::convert(const AD779XSample *samples, long *uV, unsigned char n) {	// a batch drained from an AD779XRing, each sample at its own gain
+	AD779XScale scale[3];
+	unsigned char gain[3];
+	noInterrupts();
+	for (unsigned char c = 0; c < 3; c++) {
+		scale[c] = _scale[c];
+		gain[c] = _dataGain[c];
+	}
+	interrupts();
+	for (unsigned char i = 0; i < n; i++) {
+		const AD779XSample &sample = samples[i];
+		AD779XScale &s = scale[sample.channel];
+		if (sample.gain != gain[sample.channel]) {	// converted at another gain than the channel's now, only when auto-ranged
+			gain[sample.channel] = sample.gain;
+			adcFixedScale(sample.channel, sample.gain, 1000000, s.uV, s.uVFrac);
 		}
+		uV[i] = adcFixed(sample.raw, s.zero, s.uV, s.uVFrac);
+	}
+}
+
+void AD779X::setVRef(float vRef) {
+	_vRef = vRef;
+	clearCalibration();							// full-scale coefficients follow the reference
+	adcScale();
+	if (_rangeChannels) {						// auto-ranged channels need them for their switches
+		_calSweep |= _rangeChannels;
+		adcCalibrate(INT_FULL_SCALE_CAL, _rangeChannels);
+		adcStop();
 	}
-	return _datamV[channel];
 }
-	
 
+/* Fixed-point scaling
+ *******************************************************************
+ * value = |raw - zero| * (whole + frac / 2^32), rounded half away from
+ * zero, signed like raw - zero. The scale is split at the binary point
+ * so the shift is always 32 bits: on AVR the fraction's product is
+ * built from four 16x16 multiplies (MUL) and its high word taken by
+ * moving bytes, with no 64-bit multiply and no shift loop. The scale
+ * comes from the float vRef's mantissa times 10^6 or 10^9, shifted by
+ * the gain and the code width, rounded once: exact to 2^-32 of a uV or
+ * nV for the vRef as stored. Computed by adcScale() whenever Config()
+ * or setVRef() run and for a gain switch, never per sample.
+ *******************************************************************
+ */
+
+long AD779X::adcFixed(unsigned long raw, long zero, unsigned long whole, unsigned long frac) {
+	long d = (long)raw - zero;
+	unsigned long u = d < 0 ? -d : d;			// below 2^24
+	#if defined(__AVR__)
+		unsigned int ul = u, uh = u >> 16, fl = frac, fh = frac >> 16;
+		unsigned long lo = (unsigned long)ul * fl;
+		unsigned long mid = (unsigned long)ul * fh;
+		unsigned long hi = (unsigned long)uh * fh + (mid >> 16);
+		unsigned long sum = lo + (mid << 16);
+		hi += sum < lo;
+		mid = (unsigned long)uh * fl;				// below 2^25
+		hi += mid >> 16;
+		lo = sum + (mid << 16);
+		hi += lo < sum;
+		hi += lo >> 31;							// rounded on bit 31 of the low word
+		unsigned long v = whole ? u * whole + hi : hi;	// whole is 0 for uV on the AD7799
+	#else
+		unsigned long v = u * whole + (unsigned long)(((unsigned long long)u * frac + 0x80000000ULL) >> 32);
+	#endif
+	return d < 0 ? -(long)v : (long)v;
+}
+
+void AD779X::adcFixedScale(unsigned char channel, unsigned char gain, unsigned long unit, unsigned long &whole, unsigned long &frac) {	// lsb in units per volt, as whole + frac / 2^32
+	int exponent;
+	unsigned long mantissa = (unsigned long)ldexp(frexp(_vRef, &exponent), 24);	// _vRef = mantissa * 2^(exponent - 24), exactly
+	int shift = exponent + 8 - (gain + 8*_nBytes - !(_channelConfig[channel] & 0x1000));	// lsb * 2^32 = mantissa * unit * 2^shift
+	unsigned long long value = (unsigned long long)mantissa * unit;
+	value = shift >= 0 ? value << shift : (value + (1ULL << (-shift - 1))) >> -shift;	// rounded once, to the nearest 2^-32
+	whole = value >> 32;
+	frac = (unsigned long)(value & 0xFFFFFFFFUL);
+}
+
+float AD779X::adcLsb(unsigned char channel, unsigned char gain) {	// volts per code of a channel at a gain
+	float lsb = _vRef / (1 << gain) / (1L << (8*_nBytes - 1));	// bipolar: offset binary, 2^(N-1) codes each side of mid scale (datasheet p.23)
+	return _channelConfig[channel] & 0x1000 ? lsb / 2 : lsb;	// unipolar: 2^N codes from 0V
+}
+
+void AD779X::adcScale() {
+	for (int i = 0; i < 3; i++) {					// each channel with its own gain and coding
+		_scale[i].zero = _channelConfig[i] & 0x1000 ? 0 : 1L << (8*_nBytes - 1);	// code of 0V
+		adcRescale(i, _channelConfig[i] >> 8 & 0x07);
+	}
+}
+
+void AD779X::adcRescale(unsigned char channel, unsigned char gain) {	// _scale of a channel for codes at a gain, computed as adcScale() does
+	float lsb = adcLsb(channel, gain);
+	AD779XScale &scale = _scale[channel];
+	scale.mV = lsb * 1000;
+	adcFixedScale(channel, gain, 1000000, scale.uV, scale.uVFrac);
+	adcFixedScale(channel, gain, 1000000000, scale.nV, scale.nVFrac);
+	_dataGain[channel] = gain;
+	if (_stats[channel]) {
+		_stats[channel]->scale(lsb * 1000000, 8*_nBytes);	// a new range starts a new window
+	}
+}
 
 void AD779X::cRead(unsigned char channel, unsigned char enter) {
-	unsigned char incomingByte = 0;
 	if (enter && !adcFlag(CREAD)) {
 		adcFlag(SET, CREAD);
-		incomingByte = SPI.transfer(ENTER_CREAD);
+		adcQueue(ENTER_CREAD);
 	}
-	else if (!enter && adcFlag(CREAD)) {
+	else if (!enter && adcFlag(CREAD)) {		// only while DOUT/~RDY is low, the exit command is the first byte of a data read
 		adcFlag(CLEAR, CREAD);
-		incomingByte = SPI.transfer(EXIT_CREAD);
+		adcQueue(EXIT_CREAD);
+		for (int i = 1; i < _nBytes; i++) {
+			adcQueue(STUFFIN);
+		}
+		#if AD779X_TELEMETRY
+			_frameReceived += _nBytes - 1;
+		#endif
 	}
+	adcTransfer();
 }
 
 // END of public functions
\ No newline at end of file
@@ -85,6 +85,13 @@
 #endif
 
 #include "SPI.h"
+#include "AD779XTransport.h"
+#include "AD779XAsync.h"
+#include "AD779XRing.h"
+#include "AD779XFilter.h"
+#include "AD779XStats.h"
+#include "AD779XTrace.h"
+#include "AD779XExport.h"
 
 // Communication Register
 #define READ_REG				0x40
@@ -129,41 +136,299 @@
 #define FIRST_MEASUREMENT		0x01
 #define CALIBRATE				0x02
 #define CREAD					0x03
+#define IRQ_MODE				0x04
+#define CONTINUOUS				0x05
+#define CONFIG_PENDING			0x06
+#define CAL_WAIT				0x07
+
+// Setup steps, State()
+#define AD779X_READY			0x00	// conversions run
+#define AD779X_RESET			0x01	// waiting 500us after a reset
+#define AD779X_STOP				0x02	// ending streaming, CREAD is left on the next ~RDY
+#define AD779X_CONFIG			0x03	// applying Config()
+#define AD779X_CALIBRATE		0x04	// calibrating the scan slots one at a time
+#define AD779X_RECOVER			0x05	// replaying the registers after a fault reset
+
+// Register shadow, valid and dirty bits
+#define SHADOW_MODE				0x01
+#define SHADOW_CONFIG			0x02
+#define SHADOW_IO				0x04
+
+// Build options: AD779X_TRANSPORT, AD779X_SLOTS, AD779X_CAL_ENTRIES, AD779X_TELEMETRY,
+// AD779X_TRACE and AD779X_ASYNC change the members of AD779X, so they must be set for the
+// whole project (-D in the build flags, e.g. platformio.ini build_flags). A #define in the
+// sketch reaches only the sketch, AD779X.cpp would be built with another class layout.
+
+// SPI
+#define AD779X_SPI_CLOCK		4000000	// default SCLK, up to 5MHz (datasheet p.6)
+#ifndef AD779X_TRANSPORT
+#define AD779X_TRANSPORT		AD779XArduinoSPI	// bus and pin access policy, see AD779XTransport.h
+#endif
+#define AD779X_FRAME_SIZE		32		// status + data + CONFIG/IO/MODE writes of one burst with a gain switch, or a slot replayed and read back
+
+// Scan
+#ifndef AD779X_SLOTS
+#define AD779X_SLOTS			16		// scan table length, a channel may take several slots (up to 16)
+#endif
+
+// Calibration cache
+#ifndef AD779X_CAL_ENTRIES
+#define AD779X_CAL_ENTRIES		8		// (channel, gain, buffer) ranges kept, 8 per auto-ranged channel to reach every gain
+#endif
+#define AD779X_CAL_BLOB_SIZE	(5 + 7 * AD779X_CAL_ENTRIES)
+
+// DOUT/~RDY interrupt
+#define AD779X_IRQ_SLOTS		2	// number of instances that can wait on an interrupt at the same time
 
 #define DEBUG_ADC 				0	// set to 1 for debugging
 
+// Telemetry
+#ifndef AD779X_TELEMETRY
+#define AD779X_TELEMETRY		1	// set to 0 to compile the counters out
+#endif
+#define AD779X_LATENCY_BINS		20	// bin i: 2^(i-1) to 2^i - 1 us, the last one open ended
+
+// SPI trace
+#ifndef AD779X_TRACE
+#define AD779X_TRACE			1	// set to 0 to compile the trace hooks out
+#endif
+
+// Asynchronous bursts
+#ifndef AD779X_ASYNC
+#define AD779X_ASYNC			1	// set to 0 to compile the engine hooks out
+#endif
+
+#if AD779X_TELEMETRY
+#define AD779X_COUNT(field, n)	(_telemetry.field += (n))
+#else
+#define AD779X_COUNT(field, n)	((void)0)
+#endif
+
+
+struct AD779XTelemetry
+{
+	unsigned long samples[3];		// samples read per physical channel
+	unsigned long notReady;			// DOUT/~RDY checks that found no result yet
+	unsigned long timeouts;			// conversions or CREAD exits that never completed
+	unsigned long errors;			// samples with ERR: over or underrange
+	unsigned long noRef;			// samples with NOREF, not seen in CREAD (ERR is inferred from clipped codes there)
+	unsigned long resets;
+	unsigned long calibrations;		// measured, cache hits not included
+	unsigned long recoveries;		// register replays after a fault reset
+	unsigned long recoveryFailures;	// replays the chip did not read back
+	unsigned long spiSent;			// bytes carrying commands and register writes
+	unsigned long spiReceived;		// bytes carrying register values
+	unsigned long writeBytes;		// register write bytes sent, communication byte included
+	unsigned long savedBytes;		// bytes not sent because the chip already held the value
+	unsigned long cachedReads;		// MODE/CONFIG/IO reads answered from the shadow
+	unsigned long rangeChanges;		// gain switches of auto-ranged channels
+	unsigned long latency[AD779X_LATENCY_BINS];	// conversion start (previous result when streaming) to data read, log2 us
+};
+
+struct AD779XScale
+{
+	long zero;						// code of 0V, mid scale when bipolar
+	float mV;						// mV per code
+	unsigned long uV, nV;			// uV and nV per code, whole part
+	unsigned long uVFrac, nVFrac;	// and fraction, in 2^-32
+};
+
+struct AD779XSnapshot
+{
+	unsigned long pass;				// number of the scan pass, from 1
+	unsigned long seq[3];			// sample number of each channel's value, from 1, 0 if not scanned
+	unsigned long timestamp[3];		// micros() when the result was read
+	unsigned long raw[3];
+	unsigned char status[3];		// ERR (0x40), NOREF (0x20)
+	unsigned char gain[3];			// G2-G0 code each value was converted with
+	unsigned char channels;			// physical channels of the scan, bit per channel
+};
+
+struct AD779XCalEntry
+{
+	unsigned char key;				// 0x80 | BUF << 6 | channel << 3 | gain, 0 when unused
+	unsigned long offset, fullScale;
+};
+
+bool AD779XStreamable(unsigned char csPin);	// DOUT/~RDY of the chip on csPin can be watched without clocking SPI, as CREAD needs
 
 class AD779X
 {
 	public:
 	 unsigned char adcFail;
 		AD779X(float vRef);
-		void Begin(int csPin);
+		void Begin(int csPin, int rdyPin = -1);
 		void Setup(unsigned char numberOfChannels = 3, unsigned char firstChannel = 0, unsigned char secondChannel = 1, unsigned char thirdChannel = 2);
+		bool Sequence(const unsigned char *channels, unsigned char n);
+		bool Schedule(unsigned char weight0, unsigned char weight1 = 0, unsigned char weight2 = 0);
 		void Config(unsigned char gain = 0x07, unsigned char coding = 0x01, unsigned char updateRate = 0x09, unsigned char buffer = 0x01, unsigned char refDet = 0x00, unsigned char burnoutCurrent = 0x00, unsigned char powerSwitch = 0x00);
+		void ConfigChannel(unsigned char channel, unsigned char gain, unsigned char coding = 0x01, unsigned char buffer = 0x01, unsigned char burnoutCurrent = 0x00);
+		bool AutoRange(unsigned char channel, unsigned char enable = 1, unsigned char lowestGain = 0x00, unsigned char highestGain = 0x07);
+		unsigned char readGain(unsigned char channel);
 		void cRead(unsigned char channel, unsigned char enter);		
+		bool Continuous(unsigned char enable = 1, unsigned char cread = 1);
 		void readID();
 		bool Update();
 		unsigned char StatusReg();
 		unsigned long readRaw(unsigned char channel);
+		unsigned long readSample(unsigned char channel, AD779XSample &sample);
+		bool snapshot(AD779XSnapshot &snapshot);
 		float readmV(unsigned char channel);
+		long readuV(unsigned char channel);
+		long readnV(unsigned char channel);
+		void convert(const unsigned long *raw, long *uV, unsigned int n, unsigned char channel);
+		void convert(const AD779XSample *samples, long *uV, unsigned char n);
+		void setVRef(float vRef);
+		unsigned int saveCalibration(unsigned char *blob, unsigned int size);
+		bool loadCalibration(const unsigned char *blob, unsigned int size);
+		void clearCalibration();
+		bool Calibrate(unsigned char calibrationMode = INT_FULL_SCALE_CAL, unsigned char channelMask = 0x07);
+		unsigned char State();
+		unsigned char Progress();
+		void attachRing(AD779XRing *ring);
+		void attachFilter(unsigned char channel, AD779XFilter *filter);
+		void attachStats(unsigned char channel, AD779XStats *stats);
+		#if AD779X_TRACE
+		void attachTrace(AD779XTrace *trace);
+		#endif
+		#if AD779X_ASYNC
+		void attachEngine(AD779XEngine *engine);
+		#endif
+		long due();
+		void setIO(unsigned char io);
+		#if AD779X_TELEMETRY
+		const AD779XTelemetry &telemetry();
+		void clearTelemetry();
+		#endif
+		void SPIClock(unsigned long clock);
 
-	private:
+	protected:
 		bool _adcPresent;
-		unsigned long _previousMillis, _settleTime, _offsetReg[3], _fullScaleReg[3], _dataRaw[3];
-		unsigned char _csPin, _nBytes, _adcChannels, _numberOfChannels, _channelIndex, _modeRegFByte, _modeRegSByte, _configRegFByte,_configRegSByte, _adcFlags, _channelArray[3];
-		float _vRef, _gain, _datamV[3];
+		unsigned long _offsetReg[3], _fullScaleReg[3];
+		volatile unsigned long _dataRaw[3], _dataTime[3], _dataSeq[3], _sampleSeq;	// latest result of each physical channel
+		volatile unsigned char _dataStatus[3], _dataGain[3], _passChannels, _dataLastStatus;	// _dataGain: G2-G0 of _dataRaw, and of _scale; _dataLastStatus: of the newest result
+		AD779XSnapshot _snapshot;			// last complete scan pass, written between two _generation steps
+		volatile unsigned char _generation;	// odd while _snapshot is being written
+		volatile unsigned long _period, _conversionStart;	// learned conversion period and start of the running conversion, us
+		unsigned long _periodNominal, _pollAt;
+		unsigned char _periods, _pollMisses, _pollHits;
+		volatile unsigned char _samplesReady;
+		unsigned char _samplesSeen, _rdyPin, _irqSlot, _csPin, _nBytes, _adcChannels, _numberOfChannels, _channelIndex, _modeRegFByte, _modeRegSByte, _configRegFByte,_configRegSByte, _adcFlags, _channelArray[AD779X_SLOTS];
+		float _vRef, _gain;
+		AD779XScale _scale[3];
+		unsigned int _channelConfig[3], _slotConfig[AD779X_SLOTS];	// CONFIG word per physical channel (channel bits clear) and per scan slot
+		unsigned int _slotRepeats;			// slots converting with the previous slot's CONFIG, bit per slot
+		unsigned char _slotChanges;			// CONFIG writes per pass of the scan table
+		unsigned char _scanChannels;		// physical channels in the scan table, bit per channel
+		AD779XCalEntry _cal[AD779X_CAL_ENTRIES];
+		unsigned char _calNext, _calModel, _calMode, _calMask, _calIndex, _step;
+		unsigned char _calGain, _calSweep;	// step within the slot (gains of its range, then its own), channels whose range is calibrated
+		unsigned int _calConfig;			// CONFIG word of the running calibration
+		unsigned char _rangeChannels, _rangePending, _rangeLimits[3], _rangeGain[3];	// auto-ranged channels, switches waiting for a burst, lowest | highest << 4, gain to switch to
+		unsigned char _rangeRecal;			// clipped channels waiting for Update() to calibrate their lowest gain
+		bool _rangeRestart;					// the burst switched a gain, the next result takes two periods
+		bool _cread;						// continuous mode may stream one channel in CREAD
+		unsigned char _newConfigRegFByte, _newConfigRegSByte, _newModeRegFByte, _newModeRegSByte;
+		unsigned long _stepStart;
+		signed char _model;
+		bool _calForce, _recover;
+		unsigned char _faults, _calValid;	// consecutive faults, channels whose _offsetReg/_fullScaleReg are on the chip
+		AD779XRing *_ring;
+		AD779XFilter *_filter[3];
+		AD779XStats *_stats[3];
+		#if AD779X_TRACE
+		AD779XTrace *_trace;
+		#endif
+		#if AD779X_ASYNC
+		AD779XEngine *_engine;
+		AD779XTransfer _transfer;
+		volatile bool _burstPending;		// _frame is the engine's until adcBurstDone()
+		#endif
+		unsigned char _burstSlot, _burstStatus, _burstStatusAt, _burstDataAt, _burstGain;	// slot read by the queued burst, where its status and data come back, its gain
+		unsigned int _chipMode, _chipConfig;
+		unsigned char _ioReg, _chipIO, _shadowValid, _shadowDirty;
+		#if AD779X_TELEMETRY
+		AD779XTelemetry _telemetry;
+		unsigned long _sampleStart;
+		unsigned char _frameReceived;
+		#endif
+		AD779X_TRANSPORT _port;
+		unsigned char _frame[AD779X_FRAME_SIZE], _frameLength;
 		long _interval;
 		void Init();
 		void adcReset();
 		void adcResetVars();
-		void adcWrite(unsigned char registerSelection, unsigned char val);
-		void adcCalibrate(unsigned char mode);
+		void adcWrite(unsigned char registerSelection, unsigned long val);
+		void adcQueueValue(unsigned char registerSelection, unsigned long val);
+		bool adcRecover();
+		void adcStage(unsigned char registerSelection, unsigned char val);
+		void adcFlush();
+		void adcScale();
+		float adcLsb(unsigned char channel, unsigned char gain);
+		static long adcFixed(unsigned long raw, long zero, unsigned long whole, unsigned long frac);
+		void adcFixedScale(unsigned char channel, unsigned char gain, unsigned long unit, unsigned long &whole, unsigned long &frac);
+		void adcQueueWrites();
+		void adcSelect();
+		void adcDeselect();
+		unsigned char adcRegBytes(unsigned char registerSelection);
+		void adcQueue(unsigned char val);
+		unsigned char adcQueueRead(unsigned char registerSelection);
+		void adcTransfer();
+		void adcFrameOut();
+		void adcFrameIn();
+		unsigned long adcFrameValue(unsigned char at, unsigned char nBytes);
+		void adcCalibrate(unsigned char mode, unsigned char channelMask = 0x07);
+		void adcSlots();
+		bool adcSlotFirst(unsigned char slot);
+		unsigned char adcSlotPeriods();
+		void adcPublish();
+		unsigned char adcCalKey(unsigned int config);
+		AD779XCalEntry *adcCalFind(unsigned char key);
+		void adcCalStore(unsigned char key, unsigned long offset, unsigned long fullScale);
+		bool adcCalPinned(unsigned char key);
+		void adcCalNext();
+		void adcRangeCheck(unsigned char channel, unsigned long raw, unsigned char statusByte);
+		void adcRangeQueue();
+		void adcRangeRecalibrate();
+		void adcRescale(unsigned char channel, unsigned char gain);
+		void adcStageConfig(unsigned int config);
 		void adcFlag(unsigned char bit, unsigned char flag);
 		// void adcCheck();
 		void startConversion(unsigned char channel);
 		bool adcFlag(unsigned char flag);
 		unsigned char adcCommRegByte(unsigned char registerAddressBits, unsigned char operation);
 		unsigned long adcRead(unsigned char registerSelection);
+		void adcSample(unsigned char statusByte);
+		template <unsigned char NBytes> void adcSampleT(unsigned char statusByte);
+		template <unsigned char NBytes> void adcBurstT(unsigned char statusByte);
+		template <unsigned char NBytes> void adcStoreT();
+		template <unsigned char NBytes> bool updateT();
+		void adcTimeout();
+		void adcStop();
+		void adcRate(unsigned char updateRate);
+		unsigned long adcExpected(unsigned char periods);
+		void adcPlan(unsigned char periods);
+		void adcLearn(unsigned long now, bool exact);
+		bool adcStopStep();
+		void adcDetect();
+		bool adcStep();
+		unsigned char adcNextStep();
+		void adcSchedule();
+		void adcConfigure();
+		bool adcCalStep();
+		unsigned char adcDoutStatus();
+		void startStream();
+		void adcArm();
+		void adcIsr();
+		bool irqUpdate();
+		static AD779X *_irqOwner[AD779X_IRQ_SLOTS];
+		static void adcIsr0();
+		static void adcIsr1();
+		#if AD779X_ASYNC
+		void adcSubmit(void (*begin)(AD779XTransfer &transfer));
+		void adcBurstDone();
+		static void adcBurstBegin(AD779XTransfer &transfer);
+		static void adcBurstDone(AD779XTransfer &transfer);
+		#endif
 };
 #endif 
\ No newline at end of file
@@ -0,0 +1,115 @@
+/*************************************************************************
+* AD779X asynchronous SPI engine
+*
+* With an engine attached (AD779X::attachEngine()), the burst that reads a
+* result (status, data and the writes that start the next conversion) is
+* not clocked by the CPU: Update() or the DOUT/~RDY ISR queues it as an
+* AD779XTransfer and returns, the engine shifts it out by DMA or from its
+* own interrupt, and its done callback stores the sample, releases the bus
+* and counts it for the next Update(). Bytes shift while loop() runs.
+*
+* Transfers run one at a time in the order they were submitted. Before
+* the first byte of a transfer its begin callback (if any) takes the bus
+* and selects the chip, after the last byte its done callback releases
+* them, so the chip select of one transfer never overlaps another's.
+* Everything else the library sends (setup steps, calibration, register
+* accesses) still blocks, after waiting for the engine to run empty.
+*
+* An engine is a subclass that implements start() and calls finish() from
+* its completion interrupt, and the sketch attaches it:
+*
+*	adc.attachEngine(&engine);
+*
+* No engine for a real part ships yet: cores with SPI DMA (SAMD, STM32,
+* ESP32, RP2040) each have their own DMA API, and an engine for one
+* starts the channel in start() and calls finish() from its transfer
+* complete interrupt. extras/host has a mock that checks the ordering
+* and the chip select framing.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_ASYNC_H
+#define AD779X_ASYNC_H
+
+#include "AD779XTransport.h"
+
+#define AD779X_ASYNC_QUEUE		8		// transfers queued at a time, a power of two
+
+struct AD779XTransfer
+{
+	unsigned char *frame;							// bytes sent, replaced by the bytes read
+	unsigned char length;							// 1 or more
+	unsigned char seq;								// stamped by submit(), in submission order
+	void (*begin)(AD779XTransfer &transfer);		// before the first byte, 0 if the submitter already holds the bus
+	void (*done)(AD779XTransfer &transfer);			// after the last byte, from the engine's interrupt
+	void *context;
+};
+
+class AD779XEngine
+{
+	public:
+		AD779XEngine() {
+			_head = 0;
+			_tail = 0;
+			_seq = 0;
+		}
+
+		virtual ~AD779XEngine() {}
+
+		bool submit(AD779XTransfer *transfer) {		// from loop() or an ISR, false if the queue is full
+			bool queued = false, first = false;
+			AD779X_ATOMIC(
+				if ((unsigned char)(_tail - _head) < AD779X_ASYNC_QUEUE) {
+					transfer->seq = _seq++;
+					_queue[_tail++ & (AD779X_ASYNC_QUEUE - 1)] = transfer;
+					first = (unsigned char)(_tail - _head) == 1;
+					queued = true;
+				}
+			);
+			if (first) {
+				next();
+			}
+			return queued;
+		}
+
+		bool idle() const {
+			return _head == _tail;
+		}
+
+		void wait() {								// until every queued transfer is done
+			while (!idle()) {
+				run();
+			}
+		}
+
+	protected:
+		virtual void start(AD779XTransfer &transfer) = 0;	// shift transfer.frame out in the background
+		virtual void run() {}						// called while wait() spins, for engines that need polling
+
+		void finish() {								// from the completion interrupt: hand the transfer back, start the next
+			AD779XTransfer *transfer = _queue[_head & (AD779X_ASYNC_QUEUE - 1)];
+			transfer->done(*transfer);				// releases the chip select before the next one takes it
+			_head++;
+			if (!idle()) {
+				next();
+			}
+		}
+
+	private:
+		AD779XTransfer *_queue[AD779X_ASYNC_QUEUE];
+		volatile unsigned char _head, _tail;		// free running, the head is in flight
+		unsigned char _seq;
+
+		void next() {
+			AD779XTransfer *transfer = _queue[_head & (AD779X_ASYNC_QUEUE - 1)];
+			if (transfer->begin) {
+				transfer->begin(*transfer);
+			}
+			start(*transfer);
+		}
+};
+
+#endif
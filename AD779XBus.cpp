@@ -0,0 +1,58 @@
+/*************************************************************************
+* AD779X bus manager
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <AD779XBus.h>
+
+AD779XBus::AD779XBus() {
+	_count = 0;
+	_next = 0;
+}
+
+bool AD779XBus::add(AD779X *adc) {
+	if (_count >= AD779X_BUS_DEVICES) {
+		return false;
+	}
+	_devices[_count++] = adc;
+	return true;
+}
+
+unsigned char AD779XBus::devices() {
+	return _count;
+}
+
+AD779X *AD779XBus::device(unsigned char index) {
+	return index < _count ? _devices[index] : 0;
+}
+
+int AD779XBus::Update() {
+	long due[AD779X_BUS_DEVICES];
+	unsigned char order[AD779X_BUS_DEVICES];
+	unsigned char n = 0;
+	for (unsigned char k = 0; k < _count; k++) {			// overdue chips, starting after the last one served
+		unsigned char i = (_next + k) % _count;
+		long d = _devices[i]->due();
+		if (d > 0) {
+			continue;
+		}
+		unsigned char j = n++;
+		while (j > 0 && due[j - 1] > d) {					// most overdue first, ties keep the round robin order
+			due[j] = due[j - 1];
+			order[j] = order[j - 1];
+			j--;
+		}
+		due[j] = d;
+		order[j] = i;
+	}
+	for (unsigned char j = 0; j < n; j++) {
+		if (_devices[order[j]]->Update()) {				// a chip that is not ready yet only costs a DOUT/~RDY check
+			_next = (order[j] + 1) % _count;
+			return order[j];
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,38 @@
+/*************************************************************************
+* AD779X bus manager
+*
+* Serves several AD779X chips sharing one SPI bus, each with its own CS
+* pin. Every chip converts on its own; Update() only spends bus time on
+* the chip whose result is due first and whose DOUT/~RDY is already low,
+* then immediately starts its next conversion, so the conversions of all
+* chips overlap and throughput grows with the number of chips.
+*
+* The chips must be polled (Begin() without an interrupt pin), a chip
+* waiting on its interrupt keeps CS low and owns the bus.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_BUS_H
+#define AD779X_BUS_H
+
+#include "AD779X.h"
+
+#define AD779X_BUS_DEVICES		8
+
+class AD779XBus
+{
+	public:
+		AD779XBus();
+		bool add(AD779X *adc);				// false once AD779X_BUS_DEVICES are attached
+		int Update();						// index of the chip that delivered a sample, -1 if none did
+		unsigned char devices();
+		AD779X *device(unsigned char index);
+
+	private:
+		AD779X *_devices[AD779X_BUS_DEVICES];
+		unsigned char _count, _next;
+};
+#endif
@@ -0,0 +1,117 @@
+/*************************************************************************
+* AD779X binary sample export
+*
+* Packs batches of AD779XSample, as drained from an AD779XRing, into
+* frames written to any Print (Serial, a SoftwareSerial, an SD file) with
+* one write() call per frame. Under 7 bytes per sample instead of the
+* 25-30 of a line of text, so a 115200 baud link carries ~1700 samples
+* per second. Frame, little endian:
+*
+*	0xA5 0x79			sync
+*	length				2 bytes, from seq to the last sample
+*	seq					4 bytes, sequence number of the first sample
+*	time				4 bytes, micros() of the first sample
+*	count				1 byte
+*	count samples		status | gain | channel (1 byte, ERR 0x40, NOREF
+*						0x20, G2-G0 in bits 4-2, channel in bits 1-0),
+*						raw (3 bytes), then for every sample but the first
+*						the time since the previous one as LEB128
+*	crc					2 bytes, CRC-16/CCITT (0x1021, from 0xFFFF) of
+*						length to the last sample
+*
+* Sequence numbers count the samples written, plus those reported lost
+* with lost(), so a reader sees ring overflows and bad frames as gaps.
+* Each frame carries its own start time and can be decoded alone.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_EXPORT_H
+#define AD779X_EXPORT_H
+
+#include "AD779XRing.h"
+
+#ifndef AD779X_EXPORT_SIZE
+#define AD779X_EXPORT_SIZE		128		// frame buffer, bytes
+#endif
+
+#define AD779X_EXPORT_SYNC0		0xA5
+#define AD779X_EXPORT_SYNC1		0x79
+#define AD779X_EXPORT_HEADER	13		// sync, length, seq, time, count
+
+class AD779XExport
+{
+	public:
+		AD779XExport() {
+			_seq = 0;
+		}
+
+		unsigned char write(Print &out, const AD779XSample *samples, unsigned char n) {	// frames up to n samples, returns how many
+			unsigned char count = 0;
+			unsigned int length = AD779X_EXPORT_HEADER;
+			while (count < n) {
+				const AD779XSample &s = samples[count];
+				unsigned long delta = count ? s.timestamp - samples[count - 1].timestamp : 0;
+				unsigned char deltaLength = count ? 1 : 0;
+				while (deltaLength < 5 && delta >> 7*deltaLength) {		// LEB128 bytes, 5 hold 32 bits
+					deltaLength++;
+				}
+				if (length + 4 + deltaLength + 2 > AD779X_EXPORT_SIZE) {	// room for the CRC too
+					break;
+				}
+				_buffer[length++] = (s.status & 0x60) | (s.gain & 0x07) << 2 | (s.channel & 0x03);
+				for (unsigned char i = 0; i < 3; i++) {
+					_buffer[length++] = s.raw >> 8*i;
+				}
+				for (unsigned char i = 1; i < deltaLength; i++, delta >>= 7) {
+					_buffer[length++] = 0x80 | (delta & 0x7F);
+				}
+				if (deltaLength) {
+					_buffer[length++] = delta;
+				}
+				count++;
+			}
+			if (!count) {
+				return 0;
+			}
+			_buffer[0] = AD779X_EXPORT_SYNC0;
+			_buffer[1] = AD779X_EXPORT_SYNC1;
+			put(2, length - 4, 2);
+			put(4, _seq, 4);
+			put(8, samples[0].timestamp, 4);
+			_buffer[12] = count;
+			unsigned int crc = 0xFFFF;
+			for (unsigned int i = 2; i < length; i++) {
+				crc ^= (unsigned int)_buffer[i] << 8;
+				for (unsigned char b = 0; b < 8; b++) {
+					crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+				}
+			}
+			put(length, crc, 2);
+			out.write(_buffer, length + 2);
+			_seq += count;
+			return count;
+		}
+
+		void lost(unsigned long n) {								// samples that never reached write(), e.g. ring overflows
+			_seq += n;
+		}
+
+		unsigned long seq() const {									// sequence number of the next sample
+			return _seq;
+		}
+
+	private:
+		void put(unsigned int at, unsigned long val, unsigned char n) {
+			for (unsigned char i = 0; i < n; i++) {
+				_buffer[at + i] = val >> 8*i;
+			}
+		}
+
+		unsigned char _buffer[AD779X_EXPORT_SIZE];
+		unsigned long _seq;
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*************************************************************************
+* AD779X per-channel filter
+*
+* Integer filter chain run on each new sample of a channel, from
+* AD779X::Update() or the DOUT/~RDY ISR, so no sample is skipped the
+* way an average kept in loop() skips them:
+*
+*	median		sliding median of an odd window, rejects single spikes
+*	cic			boxcar (order 1) or CIC (order 2, 3) decimation by R
+*	iir			first-order low pass, y += (x - y) / 2^shift
+*
+* Each stage is optional and they run in this order, the IIR at the
+* decimated rate. Every stage works on raw codes with integer math only.
+* The CIC runs modulo 2^32 with R^order <= 256, so 24-bit codes cannot
+* overflow. The median keeps its window sorted, one removal and one
+* insertion per sample. Memory is fixed: the median window comes from a
+* caller buffer of 2 * window entries, the rest is a few words.
+*
+* Outputs are read with available()/read() from loop(). As in
+* AD779XRing each counter is written by one side only: the producer
+* never blocks, read() retries instead of disabling interrupts.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_FILTER_H
+#define AD779X_FILTER_H
+
+#include "AD779XRing.h"
+
+#define AD779X_CIC_ORDER		3		// highest CIC order
+#define AD779X_CIC_GAIN			256		// largest R^order
+
+class AD779XFilter
+{
+	public:
+		AD779XFilter() {
+			_produced = 0;
+			_window = 0;
+			_medianWindow = 0;
+			_order = 0;
+			_decimation = 1;
+			_shift = 0;
+			reset();
+		}
+
+		bool median(unsigned long *buffer, unsigned char window) {		// buffer of 2 * window entries, window odd, 0 or 1 to bypass
+			if (window > 1 && (!buffer || !(window & 1))) {
+				return false;
+			}
+			_window = window > 1 ? buffer : 0;
+			_medianWindow = window > 1 ? window : 0;
+			reset();
+			return true;
+		}
+
+		bool cic(unsigned char order, unsigned char decimation) {		// order 1 is a boxcar, order 0 or decimation 1 to bypass
+			unsigned long gain = 1;
+			for (unsigned char i = 0; i < order; i++) {
+				gain *= decimation;
+			}
+			if (order > AD779X_CIC_ORDER || !decimation || gain > AD779X_CIC_GAIN) {
+				return false;
+			}
+			_order = decimation > 1 ? order : 0;
+			_decimation = _order ? decimation : 1;
+			_gain = _order ? gain : 1;
+			reset();
+			return true;
+		}
+
+		bool iir(unsigned char shift) {									// 0 to bypass, 1..8
+			if (shift > 8) {
+				return false;
+			}
+			_shift = shift;
+			reset();
+			return true;
+		}
+
+		void reset() {													// clear the state, not the settings
+			_count = 0;
+			_oldest = 0;
+			_phase = 0;
+			_skip = _order ? _order - 1 : 0;							// outputs before the combs hold a full history
+			for (unsigned char i = 0; i < AD779X_CIC_ORDER; i++) {
+				_integrator[i] = 0;
+				_comb[i] = 0;
+			}
+			_iirStarted = false;
+			_output = 0;
+			_consumed = _produced;
+		}
+
+		bool push(unsigned long raw) {									// producer side, true when an output was produced
+			unsigned long x = _medianWindow ? medianPush(raw) : raw;
+			if (_order) {
+				for (unsigned char i = 0; i < _order; i++) {			// integrators at the input rate
+					x = _integrator[i] += x;
+				}
+				if (++_phase < _decimation) {
+					return false;
+				}
+				_phase = 0;
+				for (unsigned char i = 0; i < _order; i++) {			// combs at the output rate
+					unsigned long previous = _comb[i];
+					_comb[i] = x;
+					x -= previous;
+				}
+				if (_skip) {
+					_skip--;
+					return false;
+				}
+				x /= _gain;
+			}
+			if (_shift) {
+				if (!_iirStarted) {
+					_iir = x << _shift;									// start settled on the first value
+					_iirStarted = true;
+				}
+				_iir += x - (_iir >> _shift);
+				x = _iir >> _shift;
+			}
+			_output = x;
+			AD779X_BARRIER();											// publish the value before the count
+			_produced++;
+			return true;
+		}
+
+		unsigned char available() const {								// outputs since the last read(), modulo 256
+			return _produced - _consumed;
+		}
+
+		unsigned long read() {											// consumer side, latest output
+			unsigned char produced;
+			unsigned long output;
+			do {
+				produced = _produced;
+				AD779X_BARRIER();
+				output = _output;
+				AD779X_BARRIER();
+			} while (produced != _produced);							// a new output came in while copying
+			_consumed = produced;
+			return output;
+		}
+
+	private:
+		unsigned long medianPush(unsigned long raw) {
+			unsigned long *history = _window, *sorted = _window + _medianWindow;
+			unsigned char n = _count;
+			if (n == _medianWindow) {									// drop the oldest from the sorted half
+				unsigned long oldest = history[_oldest];
+				unsigned char i = 0;
+				while (sorted[i] != oldest) {
+					i++;
+				}
+				for (n--; i < n; i++) {
+					sorted[i] = sorted[i + 1];
+				}
+			}
+			else {
+				_count++;
+			}
+			history[_oldest] = raw;
+			if (++_oldest == _medianWindow) {
+				_oldest = 0;
+			}
+			unsigned char i = n;
+			while (i > 0 && sorted[i - 1] > raw) {						// insert keeping the order
+				sorted[i] = sorted[i - 1];
+				i--;
+			}
+			sorted[i] = raw;
+			return sorted[(n + 1) / 2];									// middle of the n + 1 entries, upper middle while filling
+		}
+
+		unsigned long *_window;
+		unsigned char _medianWindow, _count, _oldest;
+		unsigned char _order, _decimation, _phase, _skip, _shift;
+		unsigned long _gain, _integrator[AD779X_CIC_ORDER], _comb[AD779X_CIC_ORDER], _iir;
+		bool _iirStarted;
+		volatile unsigned long _output;
+		volatile unsigned char _produced, _consumed;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*************************************************************************
+* AD779X sample ring
+*
+* Fixed capacity single-producer/single-consumer queue of timestamped
+* samples. The producer is AD779X::Update() or the DOUT/~RDY ISR, the
+* consumer is loop(). Neither side ever blocks or disables interrupts:
+* indices are free running bytes written by one side only, a full ring
+* drops the new sample and counts an overflow.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_RING_H
+#define AD779X_RING_H
+
+#if defined(__AVR__)
+#define AD779X_BARRIER()	__asm__ __volatile__("" ::: "memory")	// single core, keep the compiler from reordering
+#else
+#define AD779X_BARRIER()	__sync_synchronize()
+#endif
+
+struct AD779XSample
+{
+	unsigned long timestamp;		// micros() when the result was read
+	unsigned long raw;				// data register
+	unsigned char channel;			// physical channel 0..2
+	unsigned char status;			// status register, ERR (0x40) and NOREF (0x20)
+	unsigned char gain;				// G2-G0 code of the conversion, the range raw is in
+};
+
+class AD779XRing
+{
+	public:
+		AD779XRing(AD779XSample *buffer, unsigned char size) {		// size is a power of two, 2 to 128
+			_buffer = buffer;
+			_mask = size - 1;
+			_head = 0;
+			_tail = 0;
+			_overflows = 0;
+		}
+
+		bool push(const AD779XSample &sample) {						// producer side
+			unsigned char head = _head;
+			if ((unsigned char)(head - _tail) > _mask) {
+				_overflows++;
+				return false;
+			}
+			_buffer[head & _mask] = sample;
+			AD779X_BARRIER();										// publish the record before the index
+			_head = head + 1;
+			return true;
+		}
+
+		unsigned char drain(AD779XSample *buf, unsigned char max) {	// consumer side, copy out up to max samples
+			unsigned char tail = _tail;
+			unsigned char n = _head - tail;
+			AD779X_BARRIER();
+			if (n > max) {
+				n = max;
+			}
+			for (unsigned char i = 0; i < n; i++) {
+				buf[i] = _buffer[(unsigned char)(tail + i) & _mask];
+			}
+			AD779X_BARRIER();										// done reading before the slots are handed back
+			_tail = tail + n;
+			return n;
+		}
+
+		unsigned char available() const {
+			return _head - _tail;
+		}
+
+		unsigned long overflows() const {							// consistent copy without locking out the producer
+			unsigned long overflows;
+			do {
+				overflows = _overflows;
+			} while (overflows != _overflows);
+			return overflows;
+		}
+
+	private:
+		AD779XSample *_buffer;
+		unsigned char _mask;
+		volatile unsigned char _head, _tail;
+		volatile unsigned long _overflows;
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*************************************************************************
+* AD779X per-channel statistics
+*
+* Running statistics of a channel's raw codes, pushed from
+* AD779X::Update() or the DOUT/~RDY ISR like AD779XFilter: count, mean,
+* variance, minimum, maximum and peak-to-peak, and from them the rms
+* noise in LSB and uV and the effective and noise-free resolution the
+* datasheet tables quote (log2 of the full-scale codes over the rms or
+* peak-to-peak noise).
+*
+* A push is O(1) integer work: the count, the sum and the sum of squares
+* of the codes relative to the window's first code, in 64 bits. That is
+* Welford's shift without its division, so the moments are exact, and
+* merge() combines two windows (other channels, other boards, the last
+* minutes) exactly by moving one to the other's reference. Floating
+* point only appears when a result is read, after the window is moved
+* onto its own integer mean, so the variance suffers no cancellation even
+* with float doubles. The sums stay exact while count * (code - first
+* code)^2 stays below 2^63: indefinitely for noise, 2^15 samples of
+* full-scale swings.
+*
+* The library calls scale() with its LSB size whenever Config() or
+* setVRef() change it; a different range starts a new window. Read a
+* consistent copy with copy(), or take() to read and restart the window
+* in one go; both hold interrupts off for the copy only.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_STATS_H
+#define AD779X_STATS_H
+
+#include <math.h>
+
+#include "AD779XTransport.h"
+
+class AD779XStats
+{
+	public:
+		AD779XStats() {
+			_uV = 0;
+			_bits = 24;
+			clear();
+		}
+
+		void clear() {												// start a new window
+			_count = 0;
+			_first = 0;
+			_min = 0;
+			_max = 0;
+			_sum = 0;
+			_squares = 0;
+		}
+
+		void push(unsigned long raw) {								// producer side, one conversion result
+			if (!_count) {
+				_first = raw;
+				_min = raw;
+				_max = raw;
+			}
+			long d = (long)(raw - _first);
+			_count++;
+			_sum += d;
+			_squares += (unsigned long long)((long long)d * d);
+			if (raw < _min) {
+				_min = raw;
+			}
+			if (raw > _max) {
+				_max = raw;
+			}
+		}
+
+		void merge(const AD779XStats &other) {						// exact, as if other's samples had been pushed here
+			if (!other._count) {
+				return;
+			}
+			if (!_count) {											// an empty window takes other's range as well
+				_first = other._first;
+				_min = other._min;
+				_max = other._max;
+				_uV = other._uV;
+				_bits = other._bits;
+			}
+			long long d = (long long)other._first - (long long)_first;	// other's samples relative to this reference
+			long long n = other._count;
+			_sum += other._sum + d * n;
+			_squares += other._squares + (unsigned long long)(2 * d * other._sum + d * d * n);
+			_count += other._count;
+			_min = other._min < _min ? other._min : _min;
+			_max = other._max > _max ? other._max : _max;
+		}
+
+		void scale(float uV, unsigned char bits) {					// LSB size and data width, from the library
+			if (uV != _uV || bits != _bits) {
+				AD779X_ATOMIC(
+					_uV = uV;
+					_bits = bits;
+					clear();
+				);
+			}
+		}
+
+		void copy(AD779XStats &window) const {						// consistent copy, from loop()
+			AD779X_ATOMIC(window = *this);
+		}
+
+		void take(AD779XStats &window) {							// copy, then restart the window
+			AD779X_ATOMIC(
+				window = *this;
+				clear();
+			);
+		}
+
+		unsigned long count() const {
+			return _count;
+		}
+
+		unsigned long min() const {
+			return _min;
+		}
+
+		unsigned long max() const {
+			return _max;
+		}
+
+		unsigned long peakToPeak() const {
+			return _max - _min;
+		}
+
+		double mean() const {										// codes
+			return _count ? _first + (double)_sum / _count : 0;
+		}
+
+		double variance() const {									// codes^2, sample variance (n - 1)
+			if (_count < 2) {
+				return 0;
+			}
+			long long n = _count;
+			long long shift = _sum / n;								// onto the integer mean, exactly
+			long long sum = _sum - shift * n;
+			long long squares = (long long)_squares - 2 * shift * _sum + shift * shift * n;
+			return ((double)squares - (double)sum * sum / n) / (n - 1);
+		}
+
+		double rms() const {										// rms noise, codes
+			return sqrt(variance());
+		}
+
+		double rmsuV() const {
+			return rms() * _uV;
+		}
+
+		double peakToPeakuV() const {
+			return peakToPeak() * (double)_uV;
+		}
+
+		double effectiveBits() const {								// log2(2^N / rms noise)
+			double noise = rms();
+			return noise > 0 ? _bits - log(noise) / log(2.0) : _bits;
+		}
+
+		double noiseFreeBits() const {								// log2(2^N / peak-to-peak noise)
+			return peakToPeak() ? _bits - log((double)peakToPeak()) / log(2.0) : _bits;
+		}
+
+	private:
+		unsigned long _count, _first, _min, _max;
+		long long _sum;												// codes relative to _first
+		unsigned long long _squares;
+		float _uV;													// uV per code
+		unsigned char _bits;
+};
+
+#endif
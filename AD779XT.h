@@ -0,0 +1,86 @@
+/*************************************************************************
+* AD779X with the part and the coding fixed at compile time
+*
+* AD779XT<AD7799, UNIPOLAR> myADC(2.5) behaves like AD779X, but the DATA
+* register width, the frame loops of the polled read path and the zero
+* code of readmV()/readuV() are constants instead of AD779X flags
+* tested on every call. STATUS bit 3 is still read after the reset and
+* the chip left unused (Update() returns false) if another part answers.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_T_H
+#define AD779X_T_H
+
+#include "AD779X.h"
+
+enum AD779XModel { AD7798 = 0, AD7799 = 1 };		// STATUS register bit 3
+enum AD779XCoding { BIPOLAR = 0, UNIPOLAR = 1 };	// Configuration register U/~B
+
+template <unsigned char Model>
+struct AD779XTraits;
+
+template <>
+struct AD779XTraits<AD7798>
+{
+	static constexpr unsigned char dataBytes = 2;		// DATA, OFFSET and FULL-SCALE width
+};
+
+template <>
+struct AD779XTraits<AD7799>
+{
+	static constexpr unsigned char dataBytes = 3;
+};
+
+template <AD779XModel Model, AD779XCoding Coding>
+class AD779XT : public AD779X
+{
+	public:
+		typedef AD779XTraits<Model> Traits;
+		static constexpr long zeroCode = Coding == UNIPOLAR ? 0 : 1L << (8*Traits::dataBytes - 1);	// datasheet p.23
+
+		AD779XT(float vRef) : AD779X(vRef) {
+			_model = Model;													// another part is left unused once the reset is over
+		}
+
+		void Config(unsigned char gain = 0x07, unsigned char coding = Coding, unsigned char updateRate = 0x09, unsigned char buffer = 0x01, unsigned char refDet = 0x00, unsigned char burnoutCurrent = 0x00, unsigned char powerSwitch = 0x00) {
+			(void)coding;														// fixed by the template
+			AD779X::Config(gain, Coding, updateRate, buffer, refDet, burnoutCurrent, powerSwitch);
+		}
+
+		void ConfigChannel(unsigned char channel, unsigned char gain, unsigned char coding = Coding, unsigned char buffer = 0x01, unsigned char burnoutCurrent = 0x00) {
+			(void)coding;
+			AD779X::ConfigChannel(channel, gain, Coding, buffer, burnoutCurrent);
+		}
+
+		bool Update() {
+			if (_step != AD779X_READY && !adcStep()) {
+				return false;
+			}
+			return updateT<Traits::dataBytes>();
+		}
+
+		float readmV(unsigned char channel) {
+			noInterrupts();
+			unsigned long dataRaw = _dataRaw[channel];
+			float mV = _scale[channel].mV;
+			interrupts();
+			return (float)((long)dataRaw - zeroCode) * mV;
+		}
+
+		long readuV(unsigned char channel) {
+			noInterrupts();
+			unsigned long dataRaw = _dataRaw[channel];
+			unsigned long whole = _scale[channel].uV, frac = _scale[channel].uVFrac;
+			interrupts();
+			return adcFixed(dataRaw, zeroCode, whole, frac);
+		}
+};
+
+template <AD779XModel Model, AD779XCoding Coding>
+constexpr long AD779XT<Model, Coding>::zeroCode;
+
+#endif
@@ -0,0 +1,205 @@
+/*************************************************************************
+* AD779X SPI trace
+*
+* Compact binary record of the bus traffic of one AD779X instance: every
+* chip select edge and every SPI frame, the bytes sent and the bytes that
+* came back, each stamped with micros(). Attach it with
+* AD779X::attachTrace() and stream it out with drain() (to Serial, an SD
+* card...), then replay the file on the host with hostBench --replay.
+*
+* Records, one tag byte each:
+*
+*	0x00			CS low
+*	0x01			CS high
+*	0x02			records were dropped before the next one
+*	0x03			start: version, CS pin, micros() as 4 bytes little endian
+*	0x40 | n-1		SPI frame of n bytes (1..64): n sent, then n received
+*	0x80			LEB128 microseconds since the previous record follow
+*	0xC0 | d		d (0..63) microseconds since the previous record
+*
+* A time record comes before every record that is not at the same
+* micros() as the one before it. The buffer is a byte ring with the same
+* rules as AD779XRing: one producer (the library, loop() or the DOUT/~RDY
+* ISR), one consumer, neither blocks. The indices are two bytes, so on
+* AVR drain() holds interrupts off for the one store of its index. A
+* record that does not fit is dropped whole and counted, the next one is
+* preceded by 0x02.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_TRACE_H
+#define AD779X_TRACE_H
+
+#include "AD779XRing.h"
+
+#define AD779X_TRACE_VERSION	1
+
+#define AD779X_TRACE_CS_LOW		0x00
+#define AD779X_TRACE_CS_HIGH	0x01
+#define AD779X_TRACE_GAP		0x02
+#define AD779X_TRACE_START		0x03
+#define AD779X_TRACE_FRAME		0x40	// | (length - 1)
+#define AD779X_TRACE_TIME		0x80	// LEB128 delta follows
+#define AD779X_TRACE_TICK		0xC0	// | delta, below 64us
+#define AD779X_TRACE_FRAME_MAX	64
+
+class AD779XTrace
+{
+	public:
+		AD779XTrace(unsigned char *buffer, unsigned int size) {		// size is a power of two, 16 to 32768
+			_buffer = buffer;
+			_mask = size - 1;
+			_head = 0;
+			_tail = 0;
+			_write = 0;
+			_frameLength = 0;
+			_gap = false;
+			_overflows = 0;
+			_last = 0;
+		}
+
+		void start(unsigned char csPin) {							// producer side, first record of a session
+			unsigned long now = micros();
+			_last = now;											// times in the session count from here
+			if (!reserve(7, now)) {
+				return;
+			}
+			put(AD779X_TRACE_START);
+			put(AD779X_TRACE_VERSION);
+			put(csPin);
+			for (unsigned char i = 0; i < 4; i++) {
+				put(now >> 8*i);
+			}
+			publish();
+		}
+
+		void select(bool low) {
+			if (reserve(1, micros())) {
+				put(low ? AD779X_TRACE_CS_LOW : AD779X_TRACE_CS_HIGH);
+				publish();
+			}
+		}
+
+		void sent(const unsigned char *mosi, unsigned char length) {	// before the frame is clocked, room for the answer is kept
+			_frameLength = 0;
+			if (!length || length > AD779X_TRACE_FRAME_MAX || !reserve(1 + 2*length, micros())) {
+				return;
+			}
+			put(AD779X_TRACE_FRAME | (length - 1));
+			for (unsigned char i = 0; i < length; i++) {
+				put(mosi[i]);
+			}
+			_frameLength = length;
+		}
+
+		void received(const unsigned char *miso) {					// after the frame, completes the record sent() opened
+			if (!_frameLength) {
+				return;
+			}
+			for (unsigned char i = 0; i < _frameLength; i++) {
+				put(miso[i]);
+			}
+			_frameLength = 0;
+			publish();
+		}
+
+		unsigned int drain(unsigned char *buf, unsigned int max) {	// consumer side, copy out up to max bytes
+			unsigned int tail = _tail;
+			unsigned int n = head() - tail;
+			AD779X_BARRIER();
+			if (n > max) {
+				n = max;
+			}
+			for (unsigned int i = 0; i < n; i++) {
+				buf[i] = _buffer[(tail + i) & _mask];
+			}
+			AD779X_BARRIER();										// done reading before the bytes are handed back
+			#if defined(__AVR__)
+				noInterrupts();										// the ISR must not see half an index
+				_tail = tail + n;
+				interrupts();
+			#else
+				_tail = tail + n;
+			#endif
+			return n;
+		}
+
+		unsigned int available() const {
+			return head() - _tail;
+		}
+
+		unsigned long overflows() const {							// records dropped, consistent copy without locking out the producer
+			unsigned long overflows;
+			do {
+				overflows = _overflows;
+			} while (overflows != _overflows);
+			return overflows;
+		}
+
+	private:
+		unsigned int head() const {									// two bytes on AVR, read until both halves agree
+			unsigned int head;
+			do {
+				head = _head;
+			} while (head != _head);
+			return head;
+		}
+
+		bool reserve(unsigned int length, unsigned long now) {		// gap and time records, then room for length bytes
+			unsigned long delta = now - _last;
+			unsigned int timeLength = 0;
+			if (delta >= 64) {
+				for (timeLength = 1; delta >> 7*timeLength; timeLength++) {
+				}
+				timeLength++;
+			}
+			else if (delta) {
+				timeLength = 1;
+			}
+			unsigned int total = length + timeLength + (_gap ? 1 : 0);
+			_write = _head;
+			if ((unsigned int)(_write - _tail) + total > _mask + 1) {
+				_overflows++;
+				_gap = true;
+				return false;
+			}
+			if (_gap) {
+				put(AD779X_TRACE_GAP);
+				_gap = false;
+			}
+			if (delta >= 64) {
+				put(AD779X_TRACE_TIME);
+				for (; delta >= 0x80; delta >>= 7) {
+					put(0x80 | (delta & 0x7F));
+				}
+				put(delta);
+			}
+			else if (delta) {
+				put(AD779X_TRACE_TICK | delta);
+			}
+			_last = now;
+			return true;
+		}
+
+		void put(unsigned char val) {
+			_buffer[_write++ & _mask] = val;
+		}
+
+		void publish() {
+			AD779X_BARRIER();										// publish the record before the index
+			_head = _write;
+		}
+
+		unsigned char *_buffer;
+		unsigned int _mask, _write;
+		volatile unsigned int _head, _tail;
+		unsigned char _frameLength;
+		bool _gap;
+		volatile unsigned long _overflows;
+		unsigned long _last;
+};
+
+#endif
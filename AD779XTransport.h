@@ -0,0 +1,197 @@
+/*************************************************************************
+* AD779X bus and pin access policies
+*
+* The driver reaches the chip only through a member of the policy class
+* named by AD779X_TRANSPORT, and every member is inline, so the policy
+* compiles into adcSelect(), adcTransfer() and the DOUT/~RDY checks with
+* no call or dispatch of its own:
+*
+*	AD779XArduinoSPI	SPI library, digitalWrite()/digitalRead(), any core (default)
+*	AD779XFastPins		SPI library, CS and DOUT/~RDY through port registers
+*						cached by Begin(): 2 cycles an edge instead of ~50
+*	AD779XUsartSPI		USART0 in master SPI mode (AVR), leaves the SPI port
+*						to other devices: DIN on TXD, SCLK on XCK
+*						(AD779X_USART_XCK), DOUT/~RDY on RXD
+*						(AD779X_USART_RXD); bytes go back to back through
+*						the double-buffered transmitter. USART0 is what
+*						Serial uses on an Uno or a Mega, so Serial can't
+*						be used with it. Pins default to the ATmega328P's
+*						(XCK0 on 4, RXD0 on 0); other parts need both
+*						macros set in the build flags
+*
+* The policy is chosen for the whole build, with
+* -DAD779X_TRANSPORT=AD779XFastPins in the project's build flags. It sets
+* the type of a member of AD779X, and AD779X.cpp is compiled apart from
+* the sketch, so a #define in the sketch would leave the two disagreeing
+* on the class: the macro must reach every file of the project, and every
+* AD779X of the build shares the policy. A policy of one's own (a second
+* SPI port, a bit-banged bus) is any class with the same members, in a
+* header the build flags force into every file (-include).
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_TRANSPORT_H
+#define AD779X_TRANSPORT_H
+
+// Interrupts off around statement, then back as they were: ISRs use it too
+#if defined(__AVR__)
+#define AD779X_ATOMIC(statement)	do { unsigned char sreg = SREG; cli(); statement; SREG = sreg; } while (0)	// port read-modify-write vs ISRs on the same port
+#elif defined(__ARM_ARCH_PROFILE) && __ARM_ARCH_PROFILE == 'M'
+#define AD779X_ATOMIC(statement)	do { unsigned long primask; __asm__ __volatile__("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory"); statement; __asm__ __volatile__("msr primask, %0" :: "r" (primask) : "memory"); } while (0)	// Cortex-M
+#elif defined(ESP_PLATFORM)
+#define AD779X_ATOMIC(statement)	do { UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR(); statement; portCLEAR_INTERRUPT_MASK_FROM_ISR(state); } while (0)	// this core's interrupts
+#else
+#define AD779X_ATOMIC(statement)	do { noInterrupts(); statement; interrupts(); } while (0)	// no state to read back: extras/host and extras/linux, whose ISRs don't nest
+#endif
+
+class AD779XArduinoSPI
+{
+	public:
+		void begin(unsigned char csPin) {						// CS as an output
+			_csPin = csPin;
+			pinMode(csPin, OUTPUT);
+		}
+
+		void watch(unsigned char rdyPin) {						// pin wired to DOUT/~RDY: MISO, or an interrupt pin
+			_rdyPin = rdyPin;
+		}
+
+		void clock(unsigned long clock) {						// SCLK, used from the next transaction
+			_settings = SPISettings(clock, MSBFIRST, SPI_MODE3);	// datasheet p.6-7
+		}
+
+		void usingInterrupt(unsigned char interruptNumber) {
+			SPI.usingInterrupt(interruptNumber);
+		}
+
+		void beginTransaction() {
+			SPI.beginTransaction(_settings);
+		}
+
+		void endTransaction() {
+			SPI.endTransaction();
+		}
+
+		void select() {
+			digitalWrite(_csPin, LOW);
+		}
+
+		void deselect() {
+			digitalWrite(_csPin, HIGH);
+		}
+
+		void transfer(unsigned char *buf, unsigned char n) {	// full duplex, in place
+			SPI.transfer(buf, n);
+		}
+
+		bool busy() {											// DOUT/~RDY high: no result yet
+			return digitalRead(_rdyPin);
+		}
+
+	protected:
+		SPISettings _settings;
+		unsigned char _csPin, _rdyPin;
+};
+
+class AD779XFastPins : public AD779XArduinoSPI
+{
+	#ifdef portOutputRegister
+	public:
+		void begin(unsigned char csPin) {
+			AD779XArduinoSPI::begin(csPin);
+			_csOut = portOutputRegister(digitalPinToPort(csPin));
+			_csMask = digitalPinToBitMask(csPin);
+		}
+
+		void watch(unsigned char rdyPin) {
+			AD779XArduinoSPI::watch(rdyPin);
+			_rdyIn = portInputRegister(digitalPinToPort(rdyPin));
+			_rdyMask = digitalPinToBitMask(rdyPin);
+		}
+
+		void select() {
+			AD779X_ATOMIC(*_csOut &= ~_csMask);
+		}
+
+		void deselect() {
+			AD779X_ATOMIC(*_csOut |= _csMask);
+		}
+
+		bool busy() {
+			return *_rdyIn & _rdyMask;
+		}
+
+	private:
+		#if defined(__AVR__)									// its macros read flash, which decltype can't take here
+		typedef volatile uint8_t *Register;
+		typedef uint8_t Mask;
+		#else
+		typedef decltype(portOutputRegister(0)) Register;		// volatile uint32_t * on most ARM cores
+		typedef decltype(digitalPinToBitMask(0)) Mask;			// 32 bits there, pins above bit 7 included
+		#endif
+		Register _csOut, _rdyIn;
+		Mask _csMask, _rdyMask;
+	#endif														// no port registers: the Arduino calls
+};
+
+#if defined(UDR0) && (defined(AD779X_USART_XCK) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__))
+#ifndef AD779X_USART_XCK
+#define AD779X_USART_XCK		4		// XCK0, PD4 on the ATmega328P
+#endif
+#ifndef AD779X_USART_RXD
+#define AD779X_USART_RXD		0		// RXD0, where DOUT/~RDY is read
+#endif
+
+class AD779XUsartSPI : public AD779XFastPins
+{
+	public:
+		void begin(unsigned char csPin) {
+			AD779XFastPins::begin(csPin);
+			UBRR0 = 0;
+			pinMode(AD779X_USART_XCK, OUTPUT);					// XCK as an output makes the USART the master
+			UCSR0C = (1 << UMSEL01) | (1 << UMSEL00) | (1 << UCPHA0) | (1 << UCPOL0);	// MSPIM, SPI mode 3, MSB first
+			UCSR0B = (1 << RXEN0) | (1 << TXEN0);
+			UBRR0 = _ubrr;										// set once the transmitter runs (datasheet 20.3.1 of the ATmega328P)
+		}
+
+		void watch(unsigned char rdyPin) {						// DOUT reaches the MCU on RXD, not on MISO
+			AD779XFastPins::watch(rdyPin == MISO ? AD779X_USART_RXD : rdyPin);
+		}
+
+		void clock(unsigned long clock) {						// F_CPU / (2 * (UBRR + 1))
+			unsigned long ubrr = (F_CPU / 2 + clock - 1) / clock;
+			_ubrr = ubrr > 4096 ? 4095 : ubrr ? ubrr - 1 : 0;
+		}
+
+		void usingInterrupt(unsigned char interruptNumber) {
+			(void)interruptNumber;								// no SPI library transactions to mask it in
+		}
+
+		void beginTransaction() {
+			UBRR0 = _ubrr;
+		}
+
+		void endTransaction() {
+		}
+
+		void transfer(unsigned char *buf, unsigned char n) {	// next byte queued while the current one shifts
+			unsigned char sent = 0, received = 0;
+			while (received < n) {
+				if (sent < n && sent - received < 2 && (UCSR0A & (1 << UDRE0))) {
+					UDR0 = buf[sent++];
+				}
+				if (UCSR0A & (1 << RXC0)) {
+					buf[received++] = UDR0;
+				}
+			}
+		}
+
+	private:
+		unsigned int _ubrr;
+};
+#endif
+
+#endif
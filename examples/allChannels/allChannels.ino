@@ -13,9 +13,6 @@ void setup() {
 
   Serial.begin(9600);          // initialize serial port
   SPI.begin();                 // wake up the SPI
-  SPI.setDataMode(SPI_MODE3);  // datasheet p6-7
-  SPI.setBitOrder(MSBFIRST);
-  SPI.setClockDivider(SPI_CLOCK_DIV32);  // datasheet p6
   myADC.Begin(10);             // ADC attached to CS pin 10
   myADC.Setup();               // default values: 3 channels, 0...2
   myADC.Config();              // default values: gain 124, unipolar, 80dB (50 Hz only) rejection, reference detection disabled, buffer enabled, burnout current disabled, power switch disabled
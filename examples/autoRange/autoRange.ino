@@ -0,0 +1,41 @@
+/* AD779X library
+ Auto-ranging: channel 0 measures a sensor whose output spans from
+ microvolts to volts. AutoRange() calibrates every gain once in setup(),
+ then the channel moves between gain 1 and 128 on its own, keeping the
+ result between 3/8 and 7/8 of the range. readmV() follows the input
+ across each switch; readGain() tells which gain converted it.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                // create new object, the voltage reference is 2.5V
+unsigned char lastGain = 0xFF;
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(1, 0);                     // sample only channel 0
+  myADC.Config(0, 1, 0x0A);              // gain 1, unipolar, 16.7Hz
+  if (!myADC.AutoRange(0, 1, 0, 7)) {    // gains 1 to 128, calibrated once here
+    Serial.println("calibration cache too small");  // one entry per gain of the range
+  }
+
+}
+
+void loop() {
+  if (myADC.Update()) {
+    unsigned char gain = myADC.readGain(0);
+    if (gain != lastGain) {
+      lastGain = gain;
+      Serial.print("gain ");
+      Serial.println(1 << gain);
+    }
+    Serial.print(myADC.readmV(0), 6);
+    Serial.println(" mV");
+  }
+}
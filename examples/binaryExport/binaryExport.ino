@@ -0,0 +1,41 @@
+/* AD779X library
+ Binary export: every conversion of the three channels is queued in a ring
+ and sent in CRC protected binary frames, under 7 bytes per sample instead
+ of a line of text. On the PC, AD779XExportDecoder (extras/host) turns the
+ stream into a columnar file that loads with a single mmap().
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                // create new object, the voltage reference is 2.5V
+AD779XSample samples[64];         // ring storage, a power of two
+AD779XRing ring(samples, 64);
+AD779XSample batch[16];
+AD779XExport exporter;
+unsigned long lost = 0;
+
+void setup() {
+
+  Serial.begin(115200);                  // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(3);                        // sample channels 0, 1 and 2
+  myADC.Config(7, 1, 0x01);              // gain 128, unipolar, 470Hz
+  myADC.attachRing(&ring);               // queue every sample
+
+}
+
+void loop() {
+  myADC.Update();
+  if (ring.available() >= 16) {          // a frame's worth at a time keeps the overhead low
+    unsigned char n = ring.drain(batch, 16);
+    exporter.lost(ring.overflows() - lost);    // dropped samples show as a gap in the sequence numbers
+    lost = ring.overflows();
+    for (unsigned char i = 0; i < n; ) {
+      i += exporter.write(Serial, batch + i, n - i);
+    }
+  }
+}
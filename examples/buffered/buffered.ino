@@ -0,0 +1,43 @@
+/* AD779X library
+ Buffered acquisition: every conversion of channel 0 is queued in a ring,
+ even while loop() is busy printing, and drained in batches.
+ DOUT/~RDY (MISO) is also wired to interrupt pin 2.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(1.8);                // create new object, the voltage reference is 1.8V
+AD779XSample samples[32];         // ring storage, a power of two
+AD779XRing ring(samples, 32);
+AD779XSample batch[8];
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10, 2);                    // ADC attached to CS pin 10, DOUT/~RDY to interrupt pin 2
+  myADC.Setup(1, 0);                     // sample only channel 0
+  myADC.Config(7, 1, 0x01);              // gain 128, unipolar, 470Hz
+  myADC.Continuous();                    // stream with CREAD
+  myADC.attachRing(&ring);               // queue every sample
+
+}
+
+void loop() {
+  myADC.Update();
+  unsigned char n = ring.drain(batch, 8);    // up to 8 samples at once
+  for (unsigned char i = 0; i < n; i++) {
+    Serial.print(batch[i].timestamp);
+    Serial.print("\tCH");
+    Serial.print(batch[i].channel);
+    Serial.print("\tRAW: ");
+    Serial.println(batch[i].raw, HEX);
+  }
+  if (ring.overflows()) {
+    Serial.print("Lost: ");
+    Serial.println(ring.overflows());
+  }
+}
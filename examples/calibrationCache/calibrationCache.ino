@@ -0,0 +1,49 @@
+/* AD779X library
+ Calibration cache: the coefficients of every calibrated channel/gain are
+ kept in EEPROM, so after a power cycle the configuration step restores
+ them with a few register writes instead of calibrating each channel again.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <EEPROM.h>
+#include <AD779X.h> // include the AD779X library 
+
+#define CAL_ADDRESS 0                   // EEPROM address of the blob
+
+AD779X myADC(2.5);                      // create new object, the voltage reference is 2.5V
+unsigned char blob[AD779X_CAL_BLOB_SIZE];
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(2, 0, 1);                  // sample channels 0 and 1
+  for (unsigned int i = 0; i < sizeof(blob); i++) {
+    blob[i] = EEPROM.read(CAL_ADDRESS + i);
+  }
+  if (!myADC.loadCalibration(blob, sizeof(blob))) {
+    Serial.println("No stored calibration");
+  }
+  myADC.Config(7);                       // gain 128 on both channels
+  myADC.ConfigChannel(1, 0);             // channel 1 at gain 1, calibrated or restored
+  while (myADC.State() != AD779X_READY) {  // reset, configuration and calibration run from Update()
+    myADC.Update();
+  }
+  unsigned int n = myADC.saveCalibration(blob, sizeof(blob));
+  for (unsigned int i = 0; i < n; i++) {
+    EEPROM.update(CAL_ADDRESS + i, blob[i]);    // writes only the bytes that changed
+  }
+
+}
+
+void loop() {
+  if (myADC.Update()) {                  // if new values available, print uV values
+    Serial.print("CH0 uV: ");
+    Serial.print(myADC.readuV(0));
+    Serial.print("\tCH1 uV: ");
+    Serial.println(myADC.readuV(1));
+  }
+}
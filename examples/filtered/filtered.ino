@@ -0,0 +1,40 @@
+/* AD779X library
+ Filtered channel: channel 0 streams at 470Hz, a 5 sample median removes
+ spikes, a second order CIC decimates by 16 and a light IIR smooths the
+ result. Only the ~29 outputs per second reach loop().
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                // create new object, the voltage reference is 2.5V
+AD779XFilter filter;
+unsigned long medianWindow[2 * 5];    // history and sorted copy of a 5 sample window
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(1, 0);                     // sample only channel 0
+  myADC.Config(7, 1, 0x01);              // gain 128, unipolar, 470Hz
+  myADC.Continuous();                    // stream with CREAD
+  filter.median(medianWindow, 5);
+  filter.cic(2, 16);                     // order 2, 470Hz / 16
+  filter.iir(2);                         // y += (x - y) / 4
+  myADC.attachFilter(0, &filter);        // run on every channel 0 sample
+
+}
+
+void loop() {
+  myADC.Update();
+  if (filter.available()) {
+    unsigned long raw = filter.read();
+    long uV;
+    myADC.convert(&raw, &uV, 1, 0);      // same scale as channel 0
+    Serial.print("CH0 uV: ");
+    Serial.println(uV);
+  }
+}
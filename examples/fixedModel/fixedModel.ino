@@ -0,0 +1,33 @@
+/* AD779X library
+ Fixed part: an AD7799 used unipolar on every board, so register widths and
+ the mV scale are compile time constants. A different part is detected
+ after the reset and never read.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>     // include the SPI library:
+#include <AD779XT.h> // include the fixed model AD779X library 
+
+AD779XT<AD7799, UNIPOLAR> myADC(2.5);  // create new object, the voltage reference is 2.5V
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(3);                        // sample channels 0, 1 and 2
+  myADC.Config(7);                       // gain 128, unipolar is fixed by the type
+
+}
+
+void loop() {
+  if (myADC.Update()) {                  // if new values available, print mV values
+    for (int i = 0; i < 3; i++) {
+      Serial.print("CH");
+      Serial.print(i);
+      Serial.print(" mV: ");
+      Serial.println(myADC.readmV(i), 4);
+    }
+  }
+}
@@ -0,0 +1,49 @@
+/* AD779X library
+ Noise statistics: channel 0 streams at 470Hz with its input shorted, and
+ every sample goes into an AD779XStats. Once a second the window is taken
+ and one line reports its noise. The whole run is merged into a second
+ AD779XStats. About 60 bytes a second go out instead of every sample.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                // create new object, the voltage reference is 2.5V
+AD779XStats stats, window, total;
+unsigned long nextReport;
+
+void setup() {
+
+  Serial.begin(9600);                    // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Setup(1, 0);                     // sample only channel 0
+  myADC.Config(7, 0, 0x01);              // gain 128, bipolar, 470Hz
+  myADC.Continuous();                    // stream with CREAD
+  myADC.attachStats(0, &stats);          // every channel 0 sample
+  nextReport = millis() + 1000;
+
+}
+
+void loop() {
+  myADC.Update();
+  if ((long)(millis() - nextReport) >= 0) {
+    nextReport += 1000;
+    stats.take(window);                  // the last second, the next one starts empty
+    total.merge(window);
+    Serial.print(window.count());
+    Serial.print(" samples, rms ");
+    Serial.print(window.rms(), 2);
+    Serial.print(" LSB ");
+    Serial.print(window.rmsuV(), 3);
+    Serial.print(" uV, p-p ");
+    Serial.print(window.peakToPeak());
+    Serial.print(" LSB, ENOB ");
+    Serial.print(window.effectiveBits(), 1);
+    Serial.print(", noise free ");
+    Serial.print(total.noiseFreeBits(), 1);
+    Serial.println(" bits since reset");
+  }
+}
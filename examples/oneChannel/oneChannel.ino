@@ -13,12 +13,10 @@ void setup() {
 
   Serial.begin(9600);                    // initialize serial port
   SPI.begin();                           // wake up the SPI
-  SPI.setDataMode(SPI_MODE3);            // datasheet p6-7
-  SPI.setBitOrder(MSBFIRST);
-  SPI.setClockDivider(SPI_CLOCK_DIV32);  // datasheet p6
   myADC.Begin(10);                       // ADC attached to CS pin 10
   myADC.Setup(1,0);                      // sample only channel 0
   myADC.Config();                        // default values: gain 124, unipolar, 80dB (50 Hz only) rejection, reference detection disabled, buffer enabled, burnout current disabled, power switch disabled
+  myADC.Continuous();                    // one channel only: keep converting and read each result with CREAD (3 bytes per sample)
 
 }
 
@@ -0,0 +1,33 @@
+/* AD779X library
+ SPI trace: every chip select edge and SPI frame of the session is recorded
+ with micros() stamps and streamed, as binary, over the serial port. Save
+ it on the PC (e.g. cat /dev/ttyACM0 > field.trace) and run the same
+ session on the host with: ad779x-host --replay field.trace
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                // create new object, the voltage reference is 2.5V
+unsigned char traceBuffer[256];   // byte ring, a power of two
+AD779XTrace trace(traceBuffer, 256);
+unsigned char chunk[64];
+
+void setup() {
+
+  Serial.begin(115200);                  // the trace takes ~30 bytes per sample
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.attachTrace(&trace);             // record from here on
+  myADC.Setup(3);                        // sample channels 0, 1 and 2
+  myADC.Config(7, 1, 0x05);              // gain 128, unipolar, 50Hz
+
+}
+
+void loop() {
+  myADC.Update();
+  unsigned int n = trace.drain(chunk, sizeof(chunk));
+  Serial.write(chunk, n);                // a full ring drops records, the file marks the gap
+}
@@ -0,0 +1,34 @@
+/* AD779X library
+ Weighted scan: a fast flow signal on channel 0 is converted four times
+ for every conversion of a slow temperature channel 1. Schedule() builds
+ the scan table from the weights; Sequence() takes one written by hand,
+ e.g. {0, 0, 0, 0, 1} keeps channel 0's slots together, which in
+ continuous mode saves a settling period on each of them.
+ Author: T81
+ http://www.analog.com/en/analog-to-digital-converters/ad-converters/ad7799/products/product.html
+*/
+
+#include <SPI.h>    // include the SPI library:
+#include <AD779X.h> // include the AD779X library 
+
+AD779X myADC(2.5);                      // create new object, the voltage reference is 2.5V
+
+void setup() {
+
+  Serial.begin(115200);                  // initialize serial port
+  SPI.begin();                           // wake up the SPI
+  myADC.Begin(10);                       // ADC attached to CS pin 10
+  myADC.Schedule(4, 1);                  // flow on channel 0 4x as often as temperature on channel 1
+  myADC.Config(7, 1, 0x01);              // gain 128, unipolar, 470Hz
+  myADC.Continuous();                    // back-to-back slots of a channel take one conversion period
+
+}
+
+void loop() {
+  if (myADC.Update()) {                  // a new value on one of the channels
+    Serial.print("Flow uV: ");
+    Serial.print(myADC.readuV(0));
+    Serial.print("\tTemperature uV: ");
+    Serial.println(myADC.readuV(1));
+  }
+}
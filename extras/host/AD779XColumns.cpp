@@ -0,0 +1,218 @@
+/*************************************************************************
+* AD779X export decoder and columnar capture file
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "AD779XColumns.h"
+
+static uint32_t le(const unsigned char *p, int n) {
+	uint32_t val = 0;
+	for (int i = n - 1; i >= 0; i--) {
+		val = val << 8 | p[i];
+	}
+	return val;
+}
+
+AD779XExportDecoder::AD779XExportDecoder() {
+	_have = 0;
+	_count = 0;
+	_size = 0;
+	_lastTime = 0;
+	_nextSeq = 0;
+	_started = false;
+	_seq = 0;
+	_raw = 0;
+	_timestamp = 0;
+	_channel = 0;
+	_status = 0;
+	_gain = 0;
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+AD779XExportDecoder::~AD779XExportDecoder() {
+	free(_seq);
+	free(_raw);
+	free(_timestamp);
+	free(_channel);
+	free(_status);
+	free(_gain);
+}
+
+void AD779XExportDecoder::feed(const unsigned char *data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		_frame[_have++] = data[i];
+		if (_have == 1 && _frame[0] != AD779X_EXPORT_SYNC0) {
+			_have = 0;
+			_stats.skipped++;
+		}
+		else if (_have == 2 && _frame[1] != AD779X_EXPORT_SYNC1) {
+			_have = _frame[1] == AD779X_EXPORT_SYNC0 ? 1 : 0;	// the second byte may start the real frame
+			_frame[0] = _frame[1];
+			_stats.skipped += 2 - _have;
+		}
+		else if (_have >= 4) {
+			size_t frameLength = 4 + le(_frame + 2, 2) + 2;
+			if (frameLength > sizeof(_frame)) {					// a corrupt length, not worth waiting for: too short to pass below
+				frameLength = _have;
+			}
+			if (_have == frameLength && !frame(frameLength)) {	// a bad frame: look for a sync inside it
+				_stats.crcErrors++;
+				size_t replay = frameLength - 1;
+				_have = 0;
+				_stats.skipped++;
+				feed(_frame + 1, replay);
+			}
+			else if (_have == frameLength) {
+				_have = 0;
+			}
+		}
+	}
+}
+
+bool AD779XExportDecoder::frame(size_t length) {
+	uint32_t crc = 0xFFFF;
+	for (size_t i = 2; i < length - 2; i++) {
+		crc ^= (uint32_t)_frame[i] << 8;
+		for (int b = 0; b < 8; b++) {
+			crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+		}
+	}
+	if ((crc & 0xFFFF) != le(_frame + length - 2, 2) || length < AD779X_EXPORT_HEADER + 2) {
+		return false;
+	}
+	uint32_t seq = le(_frame + 4, 4), time = le(_frame + 8, 4);
+	unsigned char n = _frame[12];
+	uint64_t timestamp = _started ? _lastTime + (uint32_t)(time - (uint32_t)_lastTime) : time;	// widened across wrap-arounds
+	if (_started && seq != _nextSeq) {
+		_stats.lost += seq - _nextSeq;
+	}
+	size_t at = AD779X_EXPORT_HEADER;
+	for (unsigned char k = 0; k < n; k++) {
+		if (at + 4 > length - 2) {
+			return false;
+		}
+		uint8_t tag = _frame[at];
+		uint32_t raw = le(_frame + at + 1, 3);
+		at += 4;
+		if (k) {
+			uint32_t delta = 0;
+			for (int shift = 0; ; shift += 7) {
+				if (at >= length - 2 || shift > 28) {
+					return false;
+				}
+				delta |= (uint32_t)(_frame[at] & 0x7F) << shift;
+				if (!(_frame[at++] & 0x80)) {
+					break;
+				}
+			}
+			timestamp += delta;
+		}
+		append(seq + k, timestamp, raw, tag & 0x03, tag & 0x60, tag >> 2 & 0x07);
+	}
+	_started = true;
+	_lastTime = timestamp;
+	_nextSeq = seq + n;
+	_stats.frames++;
+	_stats.samples += n;
+	return true;
+}
+
+void AD779XExportDecoder::append(uint32_t seq, uint64_t timestamp, uint32_t raw, uint8_t channel, uint8_t status, uint8_t gain) {
+	if (_count == _size) {
+		_size = _size ? 2*_size : 4096;
+		_seq = (uint32_t *)realloc(_seq, _size * sizeof(uint32_t));
+		_timestamp = (uint64_t *)realloc(_timestamp, _size * sizeof(uint64_t));
+		_raw = (uint32_t *)realloc(_raw, _size * sizeof(uint32_t));
+		_channel = (uint8_t *)realloc(_channel, _size);
+		_status = (uint8_t *)realloc(_status, _size);
+		_gain = (uint8_t *)realloc(_gain, _size);
+	}
+	_seq[_count] = seq;
+	_timestamp[_count] = timestamp;
+	_raw[_count] = raw;
+	_channel[_count] = channel;
+	_status[_count] = status;
+	_gain[_count] = gain;
+	_count++;
+}
+
+bool AD779XExportDecoder::save(const char *path) const {
+	AD779XColumnsHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, AD779X_COLUMNS_MAGIC, 8);
+	header.count = _count;
+	const void *data[AD779X_COLUMNS] = {_seq, _timestamp, _raw, _channel, _status, _gain};
+	const size_t width[AD779X_COLUMNS] = {4, 8, 4, 1, 1, 1};
+	uint64_t at = sizeof(header);
+	for (int c = 0; c < AD779X_COLUMNS; c++) {
+		header.offset[c] = at;
+		at = (at + _count * width[c] + 7) & ~7ULL;
+	}
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	static const unsigned char pad[8] = {0};
+	for (int c = 0; c < AD779X_COLUMNS && ok; c++) {
+		size_t bytes = _count * width[c];
+		ok = (!bytes || fwrite(data[c], 1, bytes, f) == bytes) && fwrite(pad, 1, (8 - bytes % 8) % 8, f) == (8 - bytes % 8) % 8;
+	}
+	return fclose(f) == 0 && ok;
+}
+
+AD779XColumns::AD779XColumns() {
+	_header = 0;
+	_length = 0;
+}
+
+AD779XColumns::~AD779XColumns() {
+	unmap();
+}
+
+bool AD779XColumns::map(const char *path) {
+	unmap();
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	void *p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(AD779XColumnsHeader)) {
+		p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	_header = (const AD779XColumnsHeader *)p;
+	_length = st.st_size;
+	const size_t width[AD779X_COLUMNS] = {4, 8, 4, 1, 1, 1};
+	bool ok = !memcmp(_header->magic, AD779X_COLUMNS_MAGIC, 8);
+	for (int c = 0; c < AD779X_COLUMNS && ok; c++) {
+		ok = _header->offset[c] % 8 == 0 && _header->offset[c] + _header->count * width[c] <= _length;
+	}
+	if (!ok) {
+		unmap();
+	}
+	return ok;
+}
+
+void AD779XColumns::unmap() {
+	if (_header) {
+		munmap((void *)_header, _length);
+	}
+	_header = 0;
+	_length = 0;
+}
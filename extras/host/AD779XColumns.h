@@ -0,0 +1,112 @@
+/*************************************************************************
+* AD779X export decoder and columnar capture file
+*
+* AD779XExportDecoder takes the byte stream written by AD779XExport in
+* pieces of any size, finds frames by their sync bytes, drops those whose
+* CRC fails and resynchronises on the next sync. Timestamps are widened
+* to 64 bits across micros() wrap-arounds, so captures of many hours keep
+* a monotonic time base. save() writes what was decoded as a columnar
+* file:
+*
+*	header			magic "AD779XC2", sample count, offset of each column
+*	seq				uint32_t per sample
+*	timestamp		uint64_t per sample, us
+*	raw				uint32_t per sample
+*	channel			uint8_t per sample
+*	status			uint8_t per sample
+*	gain			uint8_t per sample, G2-G0 the raw code was converted with
+*
+* Columns are 8-byte aligned and stored in host byte order, so
+* AD779XColumns maps a file with mmap() and reads it in place, without
+* parsing.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_COLUMNS_H
+#define AD779X_COLUMNS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "AD779X.h"
+
+#define AD779X_COLUMNS_MAGIC	"AD779XC2"		// C1 files had no gain column
+
+enum AD779XColumn { AD779X_COLUMN_SEQ, AD779X_COLUMN_TIMESTAMP, AD779X_COLUMN_RAW, AD779X_COLUMN_CHANNEL, AD779X_COLUMN_STATUS, AD779X_COLUMN_GAIN, AD779X_COLUMNS };
+
+struct AD779XColumnsHeader
+{
+	char magic[8];
+	uint64_t count;
+	uint64_t offset[AD779X_COLUMNS];	// from the start of the file
+};
+
+struct AD779XExportStats
+{
+	unsigned long frames;				// frames with a good CRC
+	unsigned long samples;
+	unsigned long crcErrors;			// frames dropped
+	unsigned long skipped;				// bytes discarded looking for a sync
+	unsigned long lost;					// samples missing from the sequence numbers
+};
+
+class AD779XExportDecoder
+{
+	public:
+		AD779XExportDecoder();
+		~AD779XExportDecoder();
+
+		void feed(const unsigned char *data, size_t length);
+		bool save(const char *path) const;
+
+		uint64_t count() const { return _count; }
+		const uint32_t *seq() const { return _seq; }
+		const uint64_t *timestamp() const { return _timestamp; }
+		const uint32_t *raw() const { return _raw; }
+		const uint8_t *channel() const { return _channel; }
+		const uint8_t *status() const { return _status; }
+		const uint8_t *gain() const { return _gain; }
+		const AD779XExportStats &stats() const { return _stats; }
+
+	private:
+		unsigned char _frame[AD779X_EXPORT_HEADER + 255*9 + 2];	// 255 samples with 5-byte deltas
+		size_t _have;
+		uint64_t _count, _size, _lastTime;
+		uint32_t _nextSeq, *_seq, *_raw;
+		uint64_t *_timestamp;
+		uint8_t *_channel, *_status, *_gain;
+		bool _started;
+		AD779XExportStats _stats;
+
+		bool frame(size_t length);
+		void append(uint32_t seq, uint64_t timestamp, uint32_t raw, uint8_t channel, uint8_t status, uint8_t gain);
+};
+
+class AD779XColumns
+{
+	public:
+		AD779XColumns();
+		~AD779XColumns();
+
+		bool map(const char *path);
+		void unmap();
+
+		uint64_t count() const { return _header ? _header->count : 0; }
+		const uint32_t *seq() const { return (const uint32_t *)column(AD779X_COLUMN_SEQ); }
+		const uint64_t *timestamp() const { return (const uint64_t *)column(AD779X_COLUMN_TIMESTAMP); }
+		const uint32_t *raw() const { return (const uint32_t *)column(AD779X_COLUMN_RAW); }
+		const uint8_t *channel() const { return column(AD779X_COLUMN_CHANNEL); }
+		const uint8_t *status() const { return column(AD779X_COLUMN_STATUS); }
+		const uint8_t *gain() const { return column(AD779X_COLUMN_GAIN); }
+
+	private:
+		const AD779XColumnsHeader *_header;
+		size_t _length;
+
+		const uint8_t *column(int c) const { return _header ? (const uint8_t *)_header + _header->offset[c] : 0; }
+};
+
+#endif
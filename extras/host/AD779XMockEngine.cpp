@@ -0,0 +1,74 @@
+/*************************************************************************
+* AD779X mock SPI engine
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include "AD779XMockEngine.h"
+
+AD779XMockEngine::AD779XMockEngine() {
+	_transfer = 0;
+	_at = 0;
+	_seq = 0;
+	_started = false;
+	_dueNs = 0;
+	_edges = 0;
+	_bytes = 0;
+	memset(&_stats, 0, sizeof(_stats));
+	_irq = hostPeripheral(complete, this);
+}
+
+void AD779XMockEngine::start(AD779XTransfer &transfer) {
+	if (_transfer) {
+		_stats.overlaps++;
+	}
+	if (_started && transfer.seq != _seq) {
+		_stats.orderErrors++;
+	}
+	_seq = transfer.seq + 1;
+	_started = true;
+	_transfer = &transfer;
+	_at = 0;
+	_dueNs = hostNow() * 1000 + hostByteTime();
+	_edges = hostStats().csEdges;
+	_bytes = hostStats().bytes;
+}
+
+void AD779XMockEngine::run() {					// wait() spins in virtual time
+	delayMicroseconds(1);
+}
+
+unsigned long long AD779XMockEngine::nextEvent() const {
+	if (!_transfer || _at >= _transfer->length) {
+		return HOST_NO_EVENT;
+	}
+	return (_dueNs + 999) / 1000;
+}
+
+void AD779XMockEngine::runEvent(unsigned long long now) {
+	(void)now;
+	if (hostSelected() != 1) {
+		_stats.framingErrors++;
+	}
+	_transfer->frame[_at] = hostBusByte(_transfer->frame[_at]);
+	_stats.bytes++;
+	_stats.busyNs += hostByteTime();
+	if (++_at < _transfer->length) {
+		_dueNs += hostByteTime();
+		return;
+	}
+	if (hostStats().csEdges != _edges) {
+		_stats.framingErrors++;
+	}
+	_stats.foreignBytes += hostStats().bytes - _bytes - _transfer->length;
+	hostRaise(_irq);
+}
+
+void AD779XMockEngine::complete(void *context) {	// the completion interrupt
+	AD779XMockEngine *engine = (AD779XMockEngine *)context;
+	engine->_transfer = 0;
+	engine->_stats.transfers++;
+	engine->finish();
+}
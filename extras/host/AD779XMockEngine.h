@@ -0,0 +1,67 @@
+/*************************************************************************
+* AD779X mock SPI engine
+*
+* An AD779XEngine for the host harness, standing in for DMA: a started
+* transfer shifts one byte per byte time of the virtual clock through the
+* selected devices, costing no CPU, and its completion is a peripheral
+* interrupt (hostRaise()), served like any other ISR. Attach it to a pin
+* no device uses, its byte times are events of the virtual clock.
+*
+* On the way it checks what the library promises an engine: transfers
+* start in submission order and never overlap, exactly one chip is
+* selected for every byte of a transfer, no chip select falls during
+* one, and nothing else clocks the bus meanwhile.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_MOCK_ENGINE_H
+#define AD779X_MOCK_ENGINE_H
+
+#include "ArduinoHost.h"
+#include "AD779X.h"
+
+struct AD779XMockEngineStats
+{
+	unsigned long long transfers;		// completed
+	unsigned long long bytes;			// clocked by the engine
+	unsigned long long busyNs;			// bus time of the transfers, the CPU spent none of it
+	unsigned long long orderErrors;		// transfers started out of submission order
+	unsigned long long overlaps;		// transfers started while another was shifting
+	unsigned long long framingErrors;	// bytes without exactly one chip selected, CS falling edges within a transfer
+	unsigned long long foreignBytes;	// bytes clocked by someone else during a transfer
+};
+
+class AD779XMockEngine : public AD779XEngine, public HostDevice
+{
+	public:
+		AD779XMockEngine();				// after hostReset(), which drops peripheral interrupts
+
+		const AD779XMockEngineStats &stats() const { return _stats; }
+
+		void select(bool selected) { (void)selected; }
+		uint8_t transfer(uint8_t mosi) { (void)mosi; return 0xFF; }
+		bool dout() const { return true; }
+		unsigned long long nextEvent() const;
+		void runEvent(unsigned long long now);
+
+	protected:
+		void start(AD779XTransfer &transfer);
+		void run();
+
+	private:
+		AD779XTransfer *_transfer;		// shifting, or waiting for its completion interrupt
+		unsigned char _at;
+		unsigned char _seq;				// expected sequence number of the next start
+		bool _started;
+		int _irq;
+		unsigned long long _dueNs;		// end of the byte being shifted
+		unsigned long long _edges, _bytes;
+		AD779XMockEngineStats _stats;
+
+		static void complete(void *context);
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*************************************************************************
+* AD779X trace replay
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "AD779XReplay.h"
+#include "AD779X.h"
+
+AD779XReplay::AD779XReplay() {
+	for (int i = 0; i < 3; i++) {
+		_codes[i] = 0;
+	}
+	clear();
+}
+
+AD779XReplay::~AD779XReplay() {
+	for (int i = 0; i < 3; i++) {
+		free(_codes[i]);
+	}
+}
+
+void AD779XReplay::clear() {
+	_model = 7799;
+	_nBytes = 3;
+	_rate = -1;
+	_continuous = false;
+	_cread = false;
+	_creadExit = false;
+	_csPin = 0;
+	_phase = PHASE_COMM;
+	_bytesLeft = 0;
+	_onesCount = 0;
+	_config = 0x0710;											// the part's defaults until the trace writes them
+	for (int i = 0; i < 3; i++) {
+		free(_codes[i]);
+		_codes[i] = 0;
+		_count[i] = 0;
+		_size[i] = 0;
+		_gain[i] = -1;
+	}
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool AD779XReplay::load(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	long length = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char *data = (unsigned char *)malloc(length > 0 ? length : 1);
+	bool ok = data && fread(data, 1, length, f) == (size_t)length && decode(data, length);
+	free(data);
+	fclose(f);
+	return ok;
+}
+
+bool AD779XReplay::decode(const unsigned char *data, unsigned long length) {
+	clear();
+	if (length < 7 || data[0] != AD779X_TRACE_START || data[1] != AD779X_TRACE_VERSION) {
+		return false;
+	}
+	_csPin = data[2];
+	unsigned long long now = 0;
+	unsigned long i = 7;
+	while (i < length) {
+		unsigned char tag = data[i++];
+		if (tag >= AD779X_TRACE_TICK) {
+			now += tag & 0x3F;
+		}
+		else if (tag >= AD779X_TRACE_TIME) {
+			unsigned long long delta = 0;
+			unsigned char shift = 0;
+			do {
+				if (i >= length || shift > 63) {
+					return false;
+				}
+				delta |= (unsigned long long)(data[i] & 0x7F) << shift;
+				shift += 7;
+			} while (data[i++] & 0x80);
+			now += delta;
+		}
+		else if (tag >= AD779X_TRACE_FRAME) {
+			unsigned char n = (tag & 0x3F) + 1;
+			if (i + 2*n > length) {
+				return false;
+			}
+			for (unsigned char k = 0; k < n; k++) {
+				byte(data[i + k], data[i + n + k]);
+			}
+			i += 2*n;
+			_stats.frames++;
+			_stats.bytes += n;
+		}
+		else if (tag == AD779X_TRACE_CS_LOW) {
+			_stats.selects++;
+		}
+		else if (tag == AD779X_TRACE_GAP) {						// lost bytes, the next frame starts with a command
+			_phase = PHASE_COMM;
+			_bytesLeft = 0;
+			_stats.gaps++;
+		}
+		else if (tag != AD779X_TRACE_CS_HIGH) {
+			return false;
+		}
+	}
+	_stats.duration = now;
+	return true;
+}
+
+unsigned char AD779XReplay::registerBytes(unsigned char registerSelection) const {
+	switch (registerSelection) {
+		case MODE_REG:
+		case CONFIG_REG:
+			return 2;
+		case DATA_REG:
+		case OFFSET_REG:
+		case FULL_SCALE_REG:
+			return _nBytes;
+	}
+	return 1;
+}
+
+void AD779XReplay::byte(unsigned char mosi, unsigned char miso) {
+	_onesCount = mosi == 0xFF ? _onesCount + 1 : 0;
+	if (_onesCount >= 4) {										// 32 consecutive ones reset the part
+		_onesCount = 0;
+		_phase = PHASE_COMM;
+		_cread = false;
+		_config = 0x0710;
+		_stats.resets++;
+		return;
+	}
+	if (_phase == PHASE_COMM && _cread) {						// every CREAD frame is a data read
+		_register = DATA_REG;
+		_bytesLeft = _nBytes;
+		_shift = 0;
+		_creadExit = mosi == EXIT_CREAD;
+		_phase = PHASE_READ;
+	}
+	else if (_phase == PHASE_COMM) {
+		if (mosi & 0x80) {										// ~WEN must be 0
+			return;
+		}
+		_register = mosi & 0x38;
+		_shift = 0;
+		if (mosi & READ_REG) {
+			if (_register == DATA_REG && (mosi & 0x04)) {		// CREAD, the data follows in the next frames
+				_cread = true;
+				return;
+			}
+			_bytesLeft = registerBytes(_register);
+			_phase = PHASE_READ;
+		}
+		else if (_register != COMM_REG) {
+			_bytesLeft = registerBytes(_register);
+			_phase = PHASE_WRITE;
+		}
+		return;
+	}
+	_shift = (_shift << 8) | (_phase == PHASE_READ ? miso : mosi);
+	if (!--_bytesLeft) {
+		bool read = _phase == PHASE_READ;
+		_phase = PHASE_COMM;
+		if (_creadExit) {
+			_cread = false;
+			_creadExit = false;
+		}
+		registerDone(read, _register, _shift);
+	}
+}
+
+void AD779XReplay::registerDone(bool read, unsigned char registerSelection, unsigned long val) {
+	if (!read) {
+		_stats.registerWrites++;
+		if (registerSelection == MODE_REG) {
+			_rate = val & 0x0F;
+			if ((val >> 8 & 0xE0) == CONT_CONV_MODE) {
+				_continuous = true;
+			}
+		}
+		else if (registerSelection == CONFIG_REG) {
+			_config = val;
+		}
+		return;
+	}
+	if (registerSelection == STATUS_REG) {
+		_stats.statusReads++;
+		_model = val & 0x08 ? 7799 : 7798;
+		_nBytes = val & 0x08 ? 3 : 2;
+	}
+	else if (registerSelection == DATA_REG) {
+		_stats.dataReads++;
+		unsigned char c = _config & 0x07;
+		if (c > 2) {
+			return;
+		}
+		if (_count[c] == _size[c]) {
+			_size[c] = _size[c] ? 2*_size[c] : 256;
+			_codes[c] = (unsigned long *)realloc(_codes[c], _size[c] * sizeof(unsigned long));
+		}
+		_codes[c][_count[c]++] = val;
+		_gain[c] = _config >> 8 & 0x07;
+	}
+}
+
+void AD779XReplay::apply(AD779XSim &sim) const {
+	for (unsigned char c = 0; c < 3; c++) {
+		sim.setSequence(c, _codes[c], _count[c]);
+	}
+}
@@ -0,0 +1,70 @@
+/*************************************************************************
+* AD779X trace replay
+*
+* Reads an AD779XTrace capture and decodes the byte stream the way the
+* part does: communication register writes, register reads and writes of
+* the right width, CREAD and 32-one resets. From that it recovers the
+* session (model, update rate, per-channel gain, continuous conversion),
+* what the bus cost in the captured library version, and every
+* conversion result in order. apply() hands the results to an AD779XSim,
+* which then converts exactly the captured codes, so the current library
+* runs the field session deterministically under the virtual clock.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_REPLAY_H
+#define AD779X_REPLAY_H
+
+#include "AD779XSim.h"
+
+struct AD779XReplayStats
+{
+	unsigned long long duration;		// us from the start record to the last record
+	unsigned long bytes;				// SPI bytes in the capture
+	unsigned long frames;				// SPI frames
+	unsigned long selects;				// CS falling edges
+	unsigned long gaps;					// places where the capture dropped records
+	unsigned long dataReads;			// conversion results read
+	unsigned long statusReads;
+	unsigned long registerWrites;
+	unsigned long resets;
+};
+
+class AD779XReplay
+{
+	public:
+		AD779XReplay();
+		~AD779XReplay();
+
+		bool load(const char *path);
+		bool decode(const unsigned char *data, unsigned long length);	// false on a malformed trace
+
+		int model() const { return _model; }							// 7798, 7799
+		int rate() const { return _rate; }								// last update rate code written to MODE
+		int gain(unsigned char channel) const { return _gain[channel]; }	// gain code the channel was read at, -1 if never read
+		bool continuous() const { return _continuous; }
+		unsigned char csPin() const { return _csPin; }
+		unsigned long count(unsigned char channel) const { return _count[channel]; }
+		const unsigned long *codes(unsigned char channel) const { return _codes[channel]; }
+		const AD779XReplayStats &stats() const { return _stats; }
+		void apply(AD779XSim &sim) const;								// every channel converts its captured codes, in order
+
+	private:
+		enum Phase { PHASE_COMM, PHASE_READ, PHASE_WRITE };
+
+		int _model, _rate, _gain[3];
+		bool _continuous, _cread, _creadExit;
+		unsigned char _csPin, _phase, _register, _bytesLeft, _onesCount, _nBytes;
+		unsigned long _shift, _config, _count[3], _size[3], *_codes[3];
+		AD779XReplayStats _stats;
+
+		void clear();
+		void byte(unsigned char mosi, unsigned char miso);
+		void registerDone(bool read, unsigned char registerSelection, unsigned long val);
+		unsigned char registerBytes(unsigned char registerSelection) const;
+};
+
+#endif
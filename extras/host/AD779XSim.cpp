@@ -0,0 +1,413 @@
+/*************************************************************************
+* AD7798/AD7799 register level simulator
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include "AD779XSim.h"
+#include "AD779X.h"
+
+#define SIM_MD_MASK			0xE000
+#define SIM_MODE_MASK		0xF00F
+#define SIM_CONFIG_MASK		0x3737
+#define SIM_IO_MASK			0x70
+
+// conversion period (us) for each FS3-FS0 code, datasheet p.15 (code 0 is reserved)
+static const unsigned long simPeriod[16] = {2128, 2128, 4132, 8130, 16129, 20000, 25641, 30120, 51020, 59880, 59880, 80000, 100000, 120048, 160000, 239808};
+
+AD779XSim::AD779XSim(bool ad7799) {
+	_ad7799 = ad7799;
+	_nBits = ad7799 ? 24 : 16;
+	_selected = false;
+	_vRef = 2.5;
+	_refPresent = true;
+	_noise = 0;
+	_noiseSeed = 1;
+	_clockScale = 1;
+	for (int i = 0; i < 3; i++) {
+		_input[i] = 0;
+		_offsetError[i] = 0;
+		_sequence[i] = 0;
+		_sequenceLength[i] = 0;
+		_sequenceIndex[i] = 0;
+	}
+	for (int i = 0; i < 8; i++) {
+		_gainError[i] = 0;
+	}
+	reset();
+	_resetUntil = 0;
+	clearStats();
+}
+
+void AD779XSim::setInput(unsigned char channel, double volts) {
+	if (channel < 3) {
+		_input[channel] = volts;
+	}
+}
+
+void AD779XSim::setReference(double volts, bool present) {
+	_vRef = volts;
+	_refPresent = present;
+}
+
+void AD779XSim::setOffsetError(unsigned char channel, double volts) {
+	if (channel < 3) {
+		_offsetError[channel] = volts;
+	}
+}
+
+void AD779XSim::setSequence(unsigned char channel, const unsigned long *codes, unsigned long count) {
+	if (channel < 3) {
+		_sequence[channel] = count ? codes : 0;
+		_sequenceLength[channel] = count;
+		_sequenceIndex[channel] = 0;
+	}
+}
+
+void AD779XSim::setGainError(unsigned char gain, double fraction) {
+	_gainError[gain & 0x07] = fraction;
+}
+
+void AD779XSim::setNoise(double lsbRms, unsigned long seed) {
+	_noise = lsbRms;
+	_noiseSeed = seed ? seed : 1;
+}
+
+void AD779XSim::setClockScale(double scale) {
+	_clockScale = scale;
+}
+
+void AD779XSim::clearStats() {
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+unsigned long AD779XSim::conversionTime() const {
+	return (unsigned long)(simPeriod[_mode & 0x0F] * _clockScale);
+}
+
+unsigned long AD779XSim::registerValue(unsigned char registerSelection) const {
+	unsigned char c = (_config & 0x07) > 2 ? 0 : _config & 0x07;
+	switch (registerSelection) {
+		case STATUS_REG:		return _status;
+		case MODE_REG:			return _mode;
+		case CONFIG_REG:		return _config;
+		case DATA_REG:			return _data;
+		case ID_REG:			return _ad7799 ? 0x09 : 0x08;
+		case IO_REG:			return _io;
+		case OFFSET_REG:		return _offset[c];
+		case FULL_SCALE_REG:	return _fullScale[c];
+	}
+	return 0;
+}
+
+/* Serial interface
+ *******************************************************************/
+
+void AD779XSim::reset() {
+	_hung = false;
+	_phase = PHASE_COMM;
+	_cread = false;
+	_creadExit = false;
+	_bytesLeft = 0;
+	_onesCount = 0;
+	_mode = 0x000A;											// default values, datasheet p.14-16
+	_config = 0x0710;
+	_io = 0x00;
+	_data = 0;
+	_hasResult = false;
+	_fresh = false;
+	_resultTime = 0;
+	for (int i = 0; i < 3; i++) {
+		_offset[i] = midScale();
+		_fullScale[i] = nominalFullScale();
+	}
+	_status = 0x80 | (_ad7799 ? 0x08 : 0x00);
+	_resetUntil = hostNow() + 500;							// datasheet p.23: wait 500us before the next access
+	startConversion(2);										// power-on mode is continuous conversion
+	_stats.resets++;
+}
+
+unsigned char AD779XSim::registerBytes(unsigned char registerSelection) const {
+	switch (registerSelection) {
+		case MODE_REG:
+		case CONFIG_REG:
+			return 2;
+		case DATA_REG:
+		case OFFSET_REG:
+		case FULL_SCALE_REG:
+			return _nBits / 8;
+	}
+	return 1;
+}
+
+void AD779XSim::select(bool selected) {
+	_selected = selected;
+}
+
+bool AD779XSim::dout() const {
+	if (!_selected) {
+		return true;
+	}
+	if ((_phase == PHASE_READ || _phase == PHASE_CREAD) && _bytesLeft) {
+		return _shift & (1UL << (8 * _bytesLeft));			// last bit shifted out holds the line
+	}
+	return _status & 0x80;
+}
+
+uint8_t AD779XSim::transfer(uint8_t mosi) {
+	uint8_t miso = (_status & 0x80) ? 0xFF : 0x00;			// DOUT/~RDY between frames
+	_stats.bytes++;
+	_onesCount = mosi == 0xFF ? _onesCount + 1 : 0;
+	if (hostNow() < _resetUntil) {
+		_stats.violations++;
+		return 0xFF;
+	}
+	switch (_phase) {
+		case PHASE_COMM:
+			commWrite(mosi);
+			break;
+		case PHASE_CREAD:
+			if (!_bytesLeft) {									// start of a CREAD frame
+				_fresh = !(_status & 0x80);
+				if (!_fresh) {
+					_stats.staleReads++;
+				}
+				_shift = _data;
+				_bytesLeft = _nBits / 8;
+				_creadExit = mosi == EXIT_CREAD;
+			}
+			// fall through
+		case PHASE_READ:
+			_bytesLeft--;
+			miso = (_shift >> (8 * _bytesLeft)) & 0xFF;
+			if (!_bytesLeft) {
+				if (_register == DATA_REG || _phase == PHASE_CREAD) {
+					_stats.dataReads++;
+					if (_fresh) {
+						_stats.latency += hostNow() - _resultTime;
+					}
+					_status |= 0x80;							// ~RDY returns high once the data is read
+				}
+				if (_phase == PHASE_READ || _creadExit) {
+					_cread = false;
+					_phase = PHASE_COMM;
+				}
+			}
+			break;
+		case PHASE_WRITE:
+			_shift = (_shift << 8) | mosi;
+			if (!--_bytesLeft) {
+				_phase = PHASE_COMM;
+				registerWrite(_register, _shift);
+			}
+			break;
+	}
+	if (_onesCount >= 4) {									// 32 consecutive ones reset the part
+		reset();
+	}
+	return miso;
+}
+
+void AD779XSim::commWrite(uint8_t val) {
+	if (val & 0x80) {										// ~WEN must be 0
+		return;
+	}
+	_register = val & 0x38;
+	_shift = 0;
+	if (val & READ_REG) {
+		_bytesLeft = registerBytes(_register);
+		_shift = registerValue(_register);
+		if (_register == STATUS_REG) {
+			_stats.statusReads++;
+		}
+		else if (_register == DATA_REG) {
+			if ((val & 0x04) && (_mode & SIM_MD_MASK) == (CONT_CONV_MODE << 8)) {	// CREAD, only in continuous conversion
+				_cread = true;
+				_phase = PHASE_CREAD;
+				_bytesLeft = 0;
+				return;
+			}
+			_fresh = !(_status & 0x80);
+			if (!_fresh) {
+				_stats.staleReads++;
+			}
+		}
+		_phase = PHASE_READ;
+	}
+	else if (_register != COMM_REG) {						// a write to the communication register itself has no payload
+		_bytesLeft = registerBytes(_register);
+		_phase = PHASE_WRITE;
+	}
+}
+
+void AD779XSim::registerWrite(unsigned char registerSelection, unsigned long val) {
+	unsigned char c = (_config & 0x07) > 2 ? 0 : _config & 0x07;
+	_stats.registerWrites++;
+	switch (registerSelection) {
+		case MODE_REG:
+			_mode = val & SIM_MODE_MASK;
+			switch ((_mode >> 8) & 0xE0) {
+				case CONT_CONV_MODE:
+				case SNGL_CONV_MODE:
+					startConversion(2);
+					break;
+				case IDLE_MODE:
+				case PWR_DWN_MODE:
+					_busy = BUSY_NONE;
+					_eventTime = HOST_NO_EVENT;
+					break;
+				default:										// one of the calibration modes
+					_busy = BUSY_CALIBRATE;
+					_calMode = (_mode >> 8) & 0xE0;
+					_status |= 0x80;
+					_eventTime = hostNow() + 2 * conversionTime();
+					_stats.calibrations++;
+					break;
+			}
+			break;
+		case CONFIG_REG:
+			_config = val & SIM_CONFIG_MASK;
+			if (_busy == BUSY_CONVERT) {						// a new channel or range restarts the filter
+				startConversion(2);
+			}
+			break;
+		case IO_REG:
+			_io = val & SIM_IO_MASK;
+			break;
+		case OFFSET_REG:
+			_offset[c] = val;
+			break;
+		case FULL_SCALE_REG:
+			_fullScale[c] = val;
+			break;
+	}
+}
+
+/* Conversions
+ *******************************************************************/
+
+void AD779XSim::startConversion(unsigned long periods) {
+	_busy = BUSY_CONVERT;
+	_status |= 0x80;
+	_eventTime = hostNow() + periods * conversionTime();
+}
+
+void AD779XSim::hang() {
+	_hung = true;
+}
+
+unsigned long long AD779XSim::nextEvent() const {
+	return _busy == BUSY_NONE || _hung ? HOST_NO_EVENT : _eventTime;
+}
+
+void AD779XSim::runEvent(unsigned long long now) {
+	if (_busy == BUSY_CONVERT) {
+		completeConversion();
+		if ((_mode & SIM_MD_MASK) == (CONT_CONV_MODE << 8)) {
+			_eventTime = now + conversionTime();
+		}
+		else {													// single conversion returns to idle
+			_mode = (_mode & ~SIM_MD_MASK) | (IDLE_MODE << 8);
+			_busy = BUSY_NONE;
+		}
+	}
+	else if (_busy == BUSY_CALIBRATE) {
+		completeCalibration();
+		_mode = (_mode & ~SIM_MD_MASK) | (IDLE_MODE << 8);
+		_busy = BUSY_NONE;
+		_status &= ~0x80;
+	}
+}
+
+double AD779XSim::inputVolts(unsigned char channel) const {
+	if (channel < 3) {
+		return _input[channel];
+	}
+	if (channel == 7) {										// AVDD monitor, AVDD/6
+		return 5.0 / 6;
+	}
+	return 0;												// AIN1(-)/AIN1(-)
+}
+
+double AD779XSim::analog(unsigned char channel) const {		// normalized modulator input before calibration
+	unsigned char g = (_config >> 8) & 0x07;
+	unsigned char c = channel > 2 ? 0 : channel;
+	return (inputVolts(channel) + _offsetError[c]) * (1 << g) * (1 + _gainError[g]) / _vRef;
+}
+
+double AD779XSim::gauss() {
+	double u[2];
+	for (int i = 0; i < 2; i++) {
+		_noiseSeed = _noiseSeed * 1103515245UL + 12345UL;
+		u[i] = ((_noiseSeed >> 8) & 0xFFFFFF) / 16777216.0 + 1.0 / 33554432.0;
+	}
+	return sqrt(-2 * log(u[0])) * cos(6.283185307179586 * u[1]);
+}
+
+unsigned long AD779XSim::nominalFullScale() const {
+	return _ad7799 ? 0x500000UL : 0x5000UL;
+}
+
+unsigned long AD779XSim::midScale() const {
+	return 1UL << (_nBits - 1);
+}
+
+void AD779XSim::completeConversion() {
+	unsigned char channel = _config & 0x07;
+	unsigned char c = channel > 2 ? 0 : channel;
+	double m = (double)(1UL << _nBits);
+	double code = (analog(channel) * m - ((double)_offset[c] - midScale())) * nominalFullScale() / _fullScale[c];
+	if (!(_config & 0x1000)) {								// bipolar, offset binary
+		code = midScale() + code / 2;
+	}
+	if (_noise > 0) {
+		code += gauss() * _noise;
+	}
+	if (_sequence[c] && channel == c) {						// a replayed capture, the codes are final
+		code = _sequence[c][_sequenceIndex[c]++ % _sequenceLength[c]];
+		if (code == 0 || code == m - 1) {
+			code = code ? m : -1;							// clipped codes flag ERR like the part did
+		}
+	}
+	code = floor(code + 0.5);
+	if (_hasResult && !(_status & 0x80)) {
+		_stats.missed++;
+	}
+	_status &= 0x08;
+	if (code < 0 || code > m - 1) {
+		code = code < 0 ? 0 : m - 1;
+		_status |= 0x40;
+	}
+	if ((_config & 0x20) && !_refPresent) {
+		_status |= 0x60;
+	}
+	_status |= channel;
+	_data = (unsigned long)code;
+	_hasResult = true;
+	_resultTime = hostNow();
+	_stats.conversions++;
+}
+
+void AD779XSim::completeCalibration() {
+	unsigned char channel = _config & 0x07;
+	unsigned char c = channel > 2 ? 0 : channel;
+	unsigned char g = (_config >> 8) & 0x07;
+	double m = (double)(1UL << _nBits);
+	double zero = _offsetError[c] * (1 << g) * (1 + _gainError[g]) / _vRef;	// inputs shorted internally
+	switch (_calMode) {
+		case INT_ZERO_SCALE_CAL:
+			_offset[c] = (unsigned long)floor(midScale() + zero * m + 0.5);
+			break;
+		case INT_FULL_SCALE_CAL:
+			_fullScale[c] = (unsigned long)floor(nominalFullScale() * ((1 + _gainError[g]) + zero - ((double)_offset[c] - midScale()) / m) + 0.5);
+			break;
+		case SYS_ZERO_SCALE_CAL:
+			_offset[c] = (unsigned long)floor(midScale() + analog(channel) * m + 0.5);
+			break;
+		case SYS_FULL_SCALE_CAL:
+			_fullScale[c] = (unsigned long)floor(nominalFullScale() * (analog(channel) - ((double)_offset[c] - midScale()) / m) + 0.5);
+			break;
+	}
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+* AD7798/AD7799 register level simulator
+*
+* Models the serial interface (communication register state machine,
+* CREAD, 32-ones reset and the 500us recovery time), the register widths
+* of both parts, the ~RDY/ERR/NOREF status bits, the conversion and
+* calibration timing for every update rate and an ideal transfer function
+* with optional offset, gain error and noise. Counters report what the
+* driver under test did to the chip.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_SIM_H
+#define AD779X_SIM_H
+
+#include "ArduinoHost.h"
+
+struct AD779XSimStats
+{
+	unsigned long long bytes;				// bytes clocked while selected
+	unsigned long long conversions;			// results written to the data register
+	unsigned long long dataReads;			// complete data register reads
+	unsigned long long staleReads;			// data reads while ~RDY was high
+	unsigned long long missed;				// results overwritten before being read
+	unsigned long long latency;				// sum of us from a result being ready to it being read
+	unsigned long long statusReads;
+	unsigned long long registerWrites;
+	unsigned long long calibrations;
+	unsigned long long resets;
+	unsigned long long violations;			// bytes clocked during the 500us after a reset
+};
+
+class AD779XSim : public HostDevice
+{
+	public:
+		AD779XSim(bool ad7799 = true);
+
+		void setInput(unsigned char channel, double volts);		// differential input voltage of AIN1..AIN3
+		void setReference(double volts, bool present = true);
+		void setOffsetError(unsigned char channel, double volts);
+		void setGainError(unsigned char gain, double fraction);
+		void setNoise(double lsbRms, unsigned long seed = 1);
+		void setClockScale(double scale);							// > 1 for an internal clock running slow
+		void setSequence(unsigned char channel, const unsigned long *codes, unsigned long count);	// convert these codes in turn, looping, instead of the input
+		void hang();												// no conversion or calibration completes until the next reset
+
+		unsigned long registerValue(unsigned char registerSelection) const;
+		unsigned long conversionTime() const;						// us per result at the current update rate
+		bool cread() const { return _cread; }
+		const AD779XSimStats &stats() const { return _stats; }
+		void clearStats();
+
+		void select(bool selected);
+		uint8_t transfer(uint8_t mosi);
+		bool dout() const;
+		unsigned long long nextEvent() const;
+		void runEvent(unsigned long long now);
+
+	private:
+		enum Phase { PHASE_COMM, PHASE_READ, PHASE_WRITE, PHASE_CREAD };
+		enum Busy { BUSY_NONE, BUSY_CONVERT, BUSY_CALIBRATE };
+
+		bool _ad7799, _hung, _selected, _cread, _creadExit, _refPresent, _hasResult, _fresh;
+		unsigned char _nBits, _phase, _register, _bytesLeft, _onesCount, _status, _busy, _calMode;
+		unsigned long _mode, _config, _io, _data, _offset[3], _fullScale[3], _shift, _noiseSeed;
+		unsigned long long _eventTime, _resetUntil, _resultTime;
+		const unsigned long *_sequence[3];
+		unsigned long _sequenceLength[3], _sequenceIndex[3];
+		double _input[3], _offsetError[3], _gainError[8], _vRef, _noise, _clockScale;
+		AD779XSimStats _stats;
+
+		void reset();
+		unsigned char registerBytes(unsigned char registerSelection) const;
+		void commWrite(uint8_t val);
+		void registerWrite(unsigned char registerSelection, unsigned long val);
+		void startConversion(unsigned long periods);
+		void completeConversion();
+		void completeCalibration();
+		double inputVolts(unsigned char channel) const;
+		double analog(unsigned char channel) const;
+		double gauss();
+		unsigned long nominalFullScale() const;
+		unsigned long midScale() const;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*************************************************************************
+* Host (Linux) stand-in for the Arduino core
+*
+* Only the parts of the Arduino API used by the AD779X library and its
+* examples are provided. ArduinoHost.cpp implements them on a virtual
+* clock: millis()/micros() return the simulated clock,
+* delay()/delayMicroseconds() and every SPI byte advance it, and attached
+* HostDevice models (see ArduinoHost.h) are stepped along. Port registers
+* are HostPort objects that drive the same pins, for AD779XFastPins.
+* extras/linux/ArduinoLinux.cpp implements the same API on spidev and
+* the real clock.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH				0x1
+#define LOW					0x0
+
+#define INPUT				0x0
+#define OUTPUT				0x1
+#define INPUT_PULLUP		0x2
+
+#define CHANGE				1
+#define FALLING				2
+#define RISING				3
+
+#define BIN					2
+#define OCT					8
+#define DEC					10
+#define HEX					16
+
+// pin numbering of an Arduino Uno
+#define SS					10
+#define MOSI				11
+#define MISO				12
+#define SCK					13
+
+#define digitalPinToInterrupt(p)	(p)
+#define NOT_AN_INTERRUPT	-1
+
+class HostPort										// PORTx/PINx of an AVR: bit n of port p is pin 8p + n
+{
+	public:
+		explicit HostPort(uint8_t port) : _port(port) {}
+		HostPort &operator|=(uint8_t mask);
+		HostPort &operator&=(uint8_t mask);
+		operator uint8_t() const;
+
+	private:
+		uint8_t _port;
+};
+
+HostPort *hostPort(uint8_t port);
+
+#define digitalPinToPort(p)			((p) / 8)
+#define digitalPinToBitMask(p)		(1 << ((p) % 8))
+#define portOutputRegister(port)	hostPort(port)
+#define portInputRegister(port)		hostPort(port)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts();
+void interrupts();
+
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size);
+		size_t print(const char str[]);
+		size_t print(char c);
+		size_t print(unsigned char n, int base = DEC);
+		size_t print(int n, int base = DEC);
+		size_t print(unsigned int n, int base = DEC);
+		size_t print(long n, int base = DEC);
+		size_t print(unsigned long n, int base = DEC);
+		size_t print(double n, int digits = 2);
+		size_t println();
+		size_t println(const char str[]);
+		size_t println(char c);
+		size_t println(unsigned char n, int base = DEC);
+		size_t println(int n, int base = DEC);
+		size_t println(unsigned int n, int base = DEC);
+		size_t println(long n, int base = DEC);
+		size_t println(unsigned long n, int base = DEC);
+		size_t println(double n, int digits = 2);
+
+	private:
+		size_t printNumber(unsigned long n, uint8_t base);
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		virtual void flush() {}
+};
+
+class HostSerial : public Stream
+{
+	public:
+		void begin(unsigned long baud) { (void)baud; }
+		size_t write(uint8_t c);
+		int available() { return 0; }
+		int read() { return -1; }
+		int peek() { return -1; }
+};
+
+extern HostSerial Serial;
+
+#endif
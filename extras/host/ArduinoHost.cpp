@@ -0,0 +1,449 @@
+/*************************************************************************
+* Host (Linux) simulation harness
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "ArduinoHost.h"
+
+#define HOST_PINS			64
+#define HOST_DEVICES		16
+#define HOST_PERIPHERALS	4
+#define HOST_F_CPU			16000000UL
+#define HOST_PIN_NS			3500				// digitalWrite()/digitalRead() on a 16MHz AVR
+#define HOST_PORT_NS		250					// port register access, interrupts masked around a write
+#define HOST_SPI_CALL_NS	1000				// call, SPDR load and SPIF polling around every SPI.transfer()
+
+SPIClass SPI;
+
+static struct {
+	HostDevice *device;
+	uint8_t csPin;
+} hostDevices[HOST_DEVICES];
+
+static unsigned long long hostClock = 0;					// virtual time in us
+static unsigned long hostClockNs = 0;						// sub-us remainder of SPI byte times
+static unsigned long hostByteNs = 2000;						// 8 bits at 4MHz
+static uint8_t hostPinLevel[HOST_PINS];
+static bool hostMisoMirror[HOST_PINS];
+static uint8_t hostMisoLevel = HIGH;
+
+static void (*hostIsr[HOST_PINS])(void);
+static int hostIsrMode[HOST_PINS];						// kept after detach, like the AVR ISCn bits
+static bool hostIsrPending[HOST_PINS];
+static bool hostIsrMasked[HOST_PINS];					// SPI.usingInterrupt() during a transaction
+static bool hostSpiUsesIsr[HOST_PINS];
+static bool hostInterruptsOn = true;
+static bool hostInIsr = false;
+
+static struct {
+	void (*isr)(void *context);
+	void *context;
+	bool pending;
+} hostPeripherals[HOST_PERIPHERALS];
+
+static HostBusStats hostBusStats;
+
+static void hostSpend(unsigned long ns);
+
+/* Helpers
+ *******************************************************************/
+
+static uint8_t hostLineLevel() {
+	uint8_t level = HIGH;									// MISO is pulled up while nobody drives it
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (hostDevices[i].device && hostPinLevel[hostDevices[i].csPin] == LOW && !hostDevices[i].device->dout()) {
+			level = LOW;
+		}
+	}
+	return level;
+}
+
+static bool hostIsMisoPin(uint8_t pin) {
+	return pin == MISO || hostMisoMirror[pin];
+}
+
+static void hostEdge(bool falling) {
+	for (int pin = 0; pin < HOST_PINS; pin++) {
+		if (!hostIsMisoPin(pin) || !hostIsrMode[pin]) {
+			continue;
+		}
+		if (hostIsrMode[pin] == CHANGE || (falling && hostIsrMode[pin] == FALLING) || (!falling && hostIsrMode[pin] == RISING)) {
+			hostIsrPending[pin] = true;
+		}
+	}
+}
+
+static void hostUpdateLine() {
+	uint8_t level = hostLineLevel();
+	if (level != hostMisoLevel) {
+		hostEdge(level == LOW);
+	}
+	hostMisoLevel = level;
+}
+
+static void hostDispatch() {
+	if (!hostInterruptsOn || hostInIsr) {
+		return;
+	}
+	bool again = true;
+	while (again) {
+		again = false;
+		for (int pin = 0; pin < HOST_PINS; pin++) {
+			if (hostIsrPending[pin] && hostIsr[pin] && !hostIsrMasked[pin]) {
+				hostIsrPending[pin] = false;
+				hostBusStats.interrupts++;
+				hostInIsr = true;
+				hostIsr[pin]();
+				hostInIsr = false;
+				again = true;
+			}
+		}
+		for (int i = 0; i < HOST_PERIPHERALS; i++) {
+			if (hostPeripherals[i].pending) {
+				hostPeripherals[i].pending = false;
+				hostBusStats.interrupts++;
+				hostInIsr = true;
+				hostPeripherals[i].isr(hostPeripherals[i].context);
+				hostInIsr = false;
+				again = true;
+			}
+		}
+	}
+}
+
+/* Harness interface
+ *******************************************************************/
+
+void hostAttach(HostDevice *device, uint8_t csPin) {
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (!hostDevices[i].device) {
+			hostDevices[i].device = device;
+			hostDevices[i].csPin = csPin;
+			hostPinLevel[csPin] = HIGH;
+			return;
+		}
+	}
+}
+
+void hostDetach(HostDevice *device) {
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (hostDevices[i].device == device) {
+			hostDevices[i].device = 0;
+		}
+	}
+	hostUpdateLine();
+}
+
+void hostMirrorMiso(uint8_t pin) {
+	hostMisoMirror[pin] = true;
+}
+
+int hostPeripheral(void (*isr)(void *context), void *context) {
+	for (int i = 0; i < HOST_PERIPHERALS; i++) {
+		if (!hostPeripherals[i].isr) {
+			hostPeripherals[i].isr = isr;
+			hostPeripherals[i].context = context;
+			hostPeripherals[i].pending = false;
+			return i;
+		}
+	}
+	return -1;
+}
+
+void hostRaise(int irq) {
+	if (irq >= 0 && irq < HOST_PERIPHERALS) {
+		hostPeripherals[irq].pending = true;
+	}
+	hostDispatch();
+}
+
+void hostReset() {
+	memset(hostDevices, 0, sizeof(hostDevices));
+	memset(hostPeripherals, 0, sizeof(hostPeripherals));
+	hostClock = 0;
+	hostClockNs = 0;
+	hostByteNs = 2000;
+	for (int pin = 0; pin < HOST_PINS; pin++) {
+		hostPinLevel[pin] = HIGH;
+		hostMisoMirror[pin] = false;
+		hostIsr[pin] = 0;
+		hostIsrMode[pin] = 0;
+		hostIsrPending[pin] = false;
+		hostIsrMasked[pin] = false;
+		hostSpiUsesIsr[pin] = false;
+	}
+	hostMisoLevel = HIGH;
+	hostInterruptsOn = true;
+	hostInIsr = false;
+	hostClearStats();
+}
+
+unsigned long long hostNow() {
+	return hostClock;
+}
+
+void hostAdvanceTo(unsigned long long t) {
+	for (;;) {
+		HostDevice *next = 0;
+		unsigned long long nextTime = HOST_NO_EVENT;
+		for (int i = 0; i < HOST_DEVICES; i++) {
+			if (hostDevices[i].device && hostDevices[i].device->nextEvent() < nextTime) {
+				next = hostDevices[i].device;
+				nextTime = next->nextEvent();
+			}
+		}
+		if (!next || nextTime > t) {
+			break;
+		}
+		if (nextTime > hostClock) {
+			hostClock = nextTime;
+		}
+		next->runEvent(hostClock);
+		hostUpdateLine();
+		hostDispatch();										// an ISR may move the clock past t
+	}
+	if (t > hostClock) {
+		hostClock = t;
+	}
+	hostDispatch();
+}
+
+void hostAdvance(unsigned long long us) {
+	hostAdvanceTo(hostClock + us);
+}
+
+static void hostSpend(unsigned long ns) {					// CPU or bus time used by the code under test
+	hostClockNs += ns;
+	unsigned long long us = hostClockNs / 1000;
+	hostClockNs %= 1000;
+	hostAdvance(us);
+}
+
+const HostBusStats &hostStats() {
+	return hostBusStats;
+}
+
+void hostClearStats() {
+	memset(&hostBusStats, 0, sizeof(hostBusStats));
+}
+
+/* Arduino core
+ *******************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+static void hostPinWrite(uint8_t pin, uint8_t val) {
+	uint8_t previous = hostPinLevel[pin];
+	hostPinLevel[pin] = val ? HIGH : LOW;
+	if (previous == hostPinLevel[pin]) {
+		return;
+	}
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (hostDevices[i].device && hostDevices[i].csPin == pin) {
+			hostDevices[i].device->select(val == LOW);
+			if (val == LOW) {
+				hostBusStats.csEdges++;
+			}
+		}
+	}
+	hostUpdateLine();
+	hostDispatch();
+}
+
+static uint8_t hostPinRead(uint8_t pin) {
+	if (hostIsMisoPin(pin)) {
+		return hostLineLevel();
+	}
+	return hostPinLevel[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	if (pin >= HOST_PINS) {
+		return;
+	}
+	hostSpend(HOST_PIN_NS);
+	hostPinWrite(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+	hostSpend(HOST_PIN_NS);
+	hostBusStats.pinReads++;
+	if (pin >= HOST_PINS) {
+		return LOW;
+	}
+	return hostPinRead(pin);
+}
+
+/* Port registers
+ *******************************************************************/
+
+static HostPort hostPorts[HOST_PINS / 8] = {HostPort(0), HostPort(1), HostPort(2), HostPort(3), HostPort(4), HostPort(5), HostPort(6), HostPort(7)};
+
+HostPort *hostPort(uint8_t port) {
+	return port < HOST_PINS / 8 ? &hostPorts[port] : 0;
+}
+
+HostPort &HostPort::operator|=(uint8_t mask) {		// pins of the mask go high
+	hostSpend(HOST_PORT_NS);
+	for (uint8_t bit = 0; bit < 8; bit++) {
+		if (mask & (1 << bit)) {
+			hostPinWrite(_port * 8 + bit, HIGH);
+		}
+	}
+	return *this;
+}
+
+HostPort &HostPort::operator&=(uint8_t mask) {		// pins outside the mask go low
+	hostSpend(HOST_PORT_NS);
+	for (uint8_t bit = 0; bit < 8; bit++) {
+		if (!(mask & (1 << bit))) {
+			hostPinWrite(_port * 8 + bit, LOW);
+		}
+	}
+	return *this;
+}
+
+HostPort::operator uint8_t() const {
+	hostSpend(HOST_PORT_NS);
+	hostBusStats.pinReads++;
+	uint8_t levels = 0;
+	for (uint8_t bit = 0; bit < 8; bit++) {
+		levels |= hostPinRead(_port * 8 + bit) << bit;
+	}
+	return levels;
+}
+
+unsigned long millis() {
+	return (unsigned long)(hostClock / 1000);
+}
+
+unsigned long micros() {
+	return (unsigned long)hostClock;
+}
+
+void delay(unsigned long ms) {
+	hostAdvance((unsigned long long)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	hostAdvance(us);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
+	if (interruptNum < HOST_PINS) {
+		hostIsr[interruptNum] = userFunc;
+		hostIsrMode[interruptNum] = mode;
+		hostDispatch();										// a latched edge fires right away
+	}
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+	if (interruptNum < HOST_PINS) {
+		hostIsr[interruptNum] = 0;
+	}
+}
+
+void noInterrupts() {
+	hostInterruptsOn = false;
+}
+
+void interrupts() {
+	hostInterruptsOn = true;
+	hostDispatch();
+}
+
+/* SPI
+ *******************************************************************/
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	hostByteNs = 8000000000UL / settings.clock;
+	for (int pin = 0; pin < HOST_PINS; pin++) {
+		hostIsrMasked[pin] = hostSpiUsesIsr[pin];
+	}
+}
+
+void SPIClass::endTransaction() {
+	for (int pin = 0; pin < HOST_PINS; pin++) {
+		hostIsrMasked[pin] = false;
+	}
+	hostDispatch();
+}
+
+void SPIClass::usingInterrupt(uint8_t interruptNumber) {
+	if (interruptNumber < HOST_PINS) {
+		hostSpiUsesIsr[interruptNumber] = true;
+	}
+}
+
+void SPIClass::notUsingInterrupt(uint8_t interruptNumber) {
+	if (interruptNumber < HOST_PINS) {
+		hostSpiUsesIsr[interruptNumber] = false;
+	}
+}
+
+void SPIClass::setClockDivider(uint8_t clockDiv) {
+	hostByteNs = 8000000000UL / (HOST_F_CPU / clockDiv);
+}
+
+uint8_t hostBusByte(uint8_t mosi) {
+	uint8_t miso = 0xFF;
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (hostDevices[i].device && hostPinLevel[hostDevices[i].csPin] == LOW) {
+			miso &= hostDevices[i].device->transfer(mosi);
+		}
+	}
+	hostBusStats.bytes++;
+	if (hostMisoLevel == HIGH && miso != 0xFF) {			// shifting data pulls MISO low as well
+		hostBusStats.spuriousEdges++;
+		hostEdge(true);
+		hostMisoLevel = LOW;
+	}
+	return miso;
+}
+
+unsigned long hostByteTime() {
+	return hostByteNs;
+}
+
+uint8_t hostSelected() {
+	uint8_t selected = 0;
+	for (int i = 0; i < HOST_DEVICES; i++) {
+		if (hostDevices[i].device && hostPinLevel[hostDevices[i].csPin] == LOW) {
+			selected++;
+		}
+	}
+	return selected;
+}
+
+static uint8_t hostShift(uint8_t data) {
+	uint8_t miso = hostBusByte(data);
+	hostSpend(hostByteNs);
+	hostUpdateLine();
+	hostDispatch();
+	return miso;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	hostBusStats.transfers++;
+	hostSpend(HOST_SPI_CALL_NS);
+	return hostShift(data);
+}
+
+void SPIClass::transfer(void *buf, size_t count) {			// one call, bytes back to back
+	uint8_t *p = (uint8_t *)buf;
+	hostBusStats.transfers++;
+	hostSpend(HOST_SPI_CALL_NS);
+	for (size_t i = 0; i < count; i++) {
+		p[i] = hostShift(p[i]);
+	}
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+* Host (Linux) simulation harness
+*
+* Devices implementing HostDevice are attached to a chip select pin. While
+* their pin is LOW they see every SPI byte and drive the shared MISO line.
+* The virtual clock only moves when the code under test waits, transfers
+* bytes or when the harness calls hostAdvance(); device events (end of
+* conversion, end of calibration) are stepped in time order and falling
+* edges of MISO raise the interrupts attached to it. Peripherals other
+* than pins (an SPI engine) raise theirs with hostRaise(), served the
+* same way.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include "Arduino.h"
+
+#define HOST_NO_EVENT		0xFFFFFFFFFFFFFFFFULL
+
+class HostDevice
+{
+	public:
+		virtual ~HostDevice() {}
+		virtual void select(bool selected) = 0;					// chip select edge
+		virtual uint8_t transfer(uint8_t mosi) = 0;				// one full-duplex byte
+		virtual bool dout() const = 0;							// level driven on MISO between bytes
+		virtual unsigned long long nextEvent() const = 0;		// absolute time (us) of the next internal event
+		virtual void runEvent(unsigned long long now) = 0;		// process the event due at now
+};
+
+struct HostBusStats
+{
+	unsigned long long bytes;			// SPI bytes clocked
+	unsigned long long transfers;		// SPI.transfer() calls, single byte or block
+	unsigned long long csEdges;			// chip select falling edges
+	unsigned long long interrupts;		// ISR invocations
+	unsigned long long spuriousEdges;	// MISO falling edges caused by data shifting
+	unsigned long long pinReads;		// digitalRead() calls, e.g. DOUT/~RDY checks
+};
+
+void hostAttach(HostDevice *device, uint8_t csPin);
+void hostDetach(HostDevice *device);
+void hostMirrorMiso(uint8_t pin);				// pin wired to MISO, e.g. for an external interrupt
+int hostPeripheral(void (*isr)(void *context), void *context);	// interrupt of a peripheral, -1 if none is left
+void hostRaise(int irq);						// pending, runs once interrupts are on and no ISR runs
+void hostReset();								// clear clock, pins, interrupts and statistics
+
+unsigned long long hostNow();					// virtual time in us
+void hostAdvance(unsigned long long us);
+void hostAdvanceTo(unsigned long long t);
+
+uint8_t hostBusByte(uint8_t mosi);				// one byte through the selected devices, in no time: the caller models it
+unsigned long hostByteTime();					// ns per byte at the SCLK of the last SPI transaction
+uint8_t hostSelected();							// attached devices whose chip select is low
+
+const HostBusStats &hostStats();
+void hostClearStats();
+
+#endif
@@ -0,0 +1,119 @@
+/*************************************************************************
+* Host (Linux) stand-in for the Arduino Print class and Serial
+*
+* Shared by the simulation harness (ArduinoHost.cpp) and the spidev
+* backend (extras/linux), Serial writes to stdout.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+HostSerial Serial;
+
+/* Serial
+ *******************************************************************/
+
+size_t HostSerial::write(uint8_t c) {
+	return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+	size_t n = 0;
+	while (size--) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+	char buf[8 * sizeof(long) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+	*str = '\0';
+	if (base < 2) {
+		base = 10;
+	}
+	do {
+		char c = n % base;
+		n /= base;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (n);
+	return print(str);
+}
+
+size_t Print::print(const char str[]) {
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+	return printNumber(n, base);
+}
+
+size_t Print::print(int n, int base) {
+	return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+	return printNumber(n, base);
+}
+
+size_t Print::print(long n, int base) {
+	if (base == DEC && n < 0) {
+		return print('-') + printNumber(-n, base);
+	}
+	return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+	char buf[48];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return print(buf);
+}
+
+size_t Print::println() {
+	return print("\r\n");
+}
+
+size_t Print::println(const char str[]) {
+	return print(str) + println();
+}
+
+size_t Print::println(char c) {
+	return print(c) + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+	return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) {
+	return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+	return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) {
+	return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+	return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+	return print(n, digits) + println();
+}
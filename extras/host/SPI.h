@@ -0,0 +1,63 @@
+/*************************************************************************
+* Host (Linux) stand-in for the Arduino SPI library
+*
+* Bytes are routed to the HostDevice models whose chip select is low and
+* the virtual clock is advanced by the time the byte takes on the wire at
+* the current SPI clock.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0			0x00
+#define SPI_MODE1			0x04
+#define SPI_MODE2			0x08
+#define SPI_MODE3			0x0C
+
+#define LSBFIRST			0
+#define MSBFIRST			1
+
+// dividers of the 16MHz AVR system clock
+#define SPI_CLOCK_DIV2		2
+#define SPI_CLOCK_DIV4		4
+#define SPI_CLOCK_DIV8		8
+#define SPI_CLOCK_DIV16		16
+#define SPI_CLOCK_DIV32		32
+#define SPI_CLOCK_DIV64		64
+#define SPI_CLOCK_DIV128	128
+
+class SPISettings
+{
+	public:
+		SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+		SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+		uint32_t clock;
+		uint8_t bitOrder;
+		uint8_t dataMode;
+};
+
+class SPIClass
+{
+	public:
+		void begin() {}
+		void end() {}
+		void beginTransaction(SPISettings settings);
+		void endTransaction();
+		void usingInterrupt(uint8_t interruptNumber);
+		void notUsingInterrupt(uint8_t interruptNumber);
+		uint8_t transfer(uint8_t data);
+		void transfer(void *buf, size_t count);
+		void setBitOrder(uint8_t bitOrder) { (void)bitOrder; }
+		void setDataMode(uint8_t dataMode) { (void)dataMode; }
+		void setClockDivider(uint8_t clockDiv);
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,951 @@
+/*************************************************************************
+* AD779X host benchmark
+*
+* Runs the library against the AD779XSim model under the virtual clock,
+* the same way the allChannels/oneChannel sketches do, and reports what
+* the acquisition path costs: SPI bytes and chip selects per sample,
+* achieved sample rate against the selected update rate, latency from a
+* result being ready to it being read, conversions that were lost, and
+* the longest time a single Update() call kept loop() waiting. Build with
+* -DAD779X_TRANSPORT=AD779XFastPins to compare the port register policy.
+*
+* Options:
+*   --model 7798|7799     simulated part (7799)
+*   --channels 1..3       channels passed to Setup() (3)
+*   --sequence a,b,...    scan table passed to Sequence() instead, channels in slot order (off)
+*   --weights a,b,c       scan table built by Schedule() from per-channel weights (off)
+*   --gain 0..7           gain code passed to Config() (7)
+*   --gains a,b,c         gain code of channel 0, 1 and 2 through ConfigChannel() (--gain)
+*   --rate 1..15          update rate code passed to Config() (9)
+*   --seconds n           virtual time to run (10)
+*   --loop-us n           time spent by the rest of loop() per pass (100)
+*   --clock-div n         SCLK passed to SPIClock() as a divider of 16MHz (32)
+*   --irq-pin n           wire DOUT/~RDY to pin n and acquire from its interrupt (off)
+*   --continuous 0|1      stream in continuous conversion mode (0)
+*   --ring n              queue samples in an AD779XRing of n entries, drained every loop pass (off)
+*   --devices n           chips on the bus, served by AD779XBus when more than one (1)
+*   --cal-file path       load calibration coefficients from path before Config(), save them after (off)
+*   --clock-scale x       conversion time of the simulated chips relative to the datasheet (1.0)
+*   --noise lsb           rms noise of the simulated conversions in LSB (0)
+*   --filter m,o,r,s      AD779XFilter on every channel: median window m, CIC order o
+*                         decimating by r, IIR shift s, checked against a plain reference (off)
+*   --fault-every ms      hang the first chip every ms of virtual time, until the library resets
+*                         it; offset and gain errors are added so lost coefficients show (off)
+*   --trace-out path      record the first chip's bus traffic with AD779XTrace into path (off)
+*   --export path         frame every sample with AD779XExport, decode the stream and save it
+*                         as a columnar file at path, mapped back and checked (off)
+*   --replay path         run the session captured in an AD779XTrace file: model, channels, gains,
+*                         rate and continuous mode come from the capture (later options still
+*                         override them) and the chip converts the captured codes in order (off)
+*   --async 0|1           clock the result bursts with AD779XMockEngine, checking order and CS framing (0)
+*   --stats 0|1           AD779XStats on every channel, taken in 1 s windows and merged, checked against
+*                         a long double reference (0)
+*   --autorange lo,hi     AutoRange() every channel between gain codes lo and hi; readmV() is checked
+*                         against the input after every settled, unclipped sample (off)
+*   --steps ms            move every input through levels from 0.03% to 60% of the reference
+*                         every ms of virtual time (off)
+*   --no-ref 0|1          disconnect the reference with REFDET on, every sample should count NOREF (0)
+*   --set-io ms           toggle setIO() between 0x40 and 0 every ms of virtual time while acquiring (off)
+*   --status ms           call StatusReg() every ms of virtual time while acquiring (off)
+*
+* Exits with 1 when a check fails: filter, stats, export or snapshot
+* results against their references, auto-ranged readings off the input,
+* async order or framing errors, telemetry bytes off the bus count, a
+* timeout nothing injected, or an injected fault that was not recovered.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "ArduinoHost.h"
+#include "AD779XSim.h"
+#include "AD779XReplay.h"
+#include "AD779XColumns.h"
+#include "AD779XMockEngine.h"
+#include "AD779X.h"
+#include "AD779XBus.h"
+
+#define BENCH_CS_PIN		10
+#define BENCH_VREF			2.5
+#define BENCH_TRACE_SIZE	32768
+#define BENCH_EXPORT_BATCH	16
+#define BENCH_ENGINE_PIN	60				// no device on it, the mock engine's events run on the virtual clock
+#define BENCH_LEVELS		8
+
+static const double benchLevels[BENCH_LEVELS] = {0.6, 0.02, 0.15, 0.0009, 0.3, 0.004, 0.05, 0.0003};	// --steps inputs, fractions of the reference
+#define BENCH_NAME(x)		#x
+#define BENCH_STRING(x)		BENCH_NAME(x)		// AD779X_TRANSPORT as built
+
+struct BenchOptions
+{
+	int model, channels, gain, rate, clockDiv, irqPin, continuous, ring, devices, gains[3];
+	unsigned long seconds, loopUs;
+	const char *calFile;
+	double clockScale, noise;
+	int filter[4];
+	unsigned long faultEvery;
+	const char *traceOut, *replay, *exportPath, *sequence;
+	int weights[3];
+	int async, stats, autorange[2];
+	unsigned long steps;
+	int noRef;
+	unsigned long setIO, status;
+};
+
+class BenchSink : public Print								// the serial port of an exporting sketch
+{
+	public:
+		BenchSink(AD779XExportDecoder &decoder) : _decoder(decoder), bytes(0), writes(0) {}
+		size_t write(uint8_t c) {
+			return write(&c, 1);
+		}
+		size_t write(const uint8_t *buffer, size_t size) {
+			_decoder.feed(buffer, size);
+			bytes += size;
+			writes++;
+			return size;
+		}
+
+	private:
+		AD779XExportDecoder &_decoder;
+
+	public:
+		unsigned long bytes, writes;
+};
+
+static void parseOptions(int argc, char **argv, BenchOptions &opt) {
+	for (int i = 1; i + 1 < argc; i += 2) {
+		long val = atol(argv[i + 1]);
+		if (!strcmp(argv[i], "--model")) {
+			opt.model = val;
+		}
+		else if (!strcmp(argv[i], "--channels")) {
+			opt.channels = val;
+		}
+		else if (!strcmp(argv[i], "--sequence")) {
+			opt.sequence = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--weights")) {
+			sscanf(argv[i + 1], "%d,%d,%d", &opt.weights[0], &opt.weights[1], &opt.weights[2]);
+		}
+		else if (!strcmp(argv[i], "--gain")) {
+			opt.gain = val;
+		}
+		else if (!strcmp(argv[i], "--gains")) {
+			sscanf(argv[i + 1], "%d,%d,%d", &opt.gains[0], &opt.gains[1], &opt.gains[2]);
+		}
+		else if (!strcmp(argv[i], "--rate")) {
+			opt.rate = val;
+		}
+		else if (!strcmp(argv[i], "--seconds")) {
+			opt.seconds = val;
+		}
+		else if (!strcmp(argv[i], "--loop-us")) {
+			opt.loopUs = val;
+		}
+		else if (!strcmp(argv[i], "--clock-div")) {
+			opt.clockDiv = val;
+		}
+		else if (!strcmp(argv[i], "--irq-pin")) {
+			opt.irqPin = val;
+		}
+		else if (!strcmp(argv[i], "--continuous")) {
+			opt.continuous = val;
+		}
+		else if (!strcmp(argv[i], "--ring")) {
+			opt.ring = val;
+		}
+		else if (!strcmp(argv[i], "--devices")) {
+			opt.devices = val;
+		}
+		else if (!strcmp(argv[i], "--cal-file")) {
+			opt.calFile = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--clock-scale")) {
+			opt.clockScale = atof(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "--noise")) {
+			opt.noise = atof(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "--trace-out")) {
+			opt.traceOut = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--export")) {
+			opt.exportPath = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--replay")) {
+			opt.replay = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--fault-every")) {
+			opt.faultEvery = val;
+		}
+		else if (!strcmp(argv[i], "--async")) {
+			opt.async = val;
+		}
+		else if (!strcmp(argv[i], "--autorange")) {
+			sscanf(argv[i + 1], "%d,%d", &opt.autorange[0], &opt.autorange[1]);
+		}
+		else if (!strcmp(argv[i], "--steps")) {
+			opt.steps = val;
+		}
+		else if (!strcmp(argv[i], "--no-ref")) {
+			opt.noRef = val;
+		}
+		else if (!strcmp(argv[i], "--set-io")) {
+			opt.setIO = val;
+		}
+		else if (!strcmp(argv[i], "--status")) {
+			opt.status = val;
+		}
+		else if (!strcmp(argv[i], "--stats")) {
+			opt.stats = val;
+		}
+		else if (!strcmp(argv[i], "--filter")) {
+			sscanf(argv[i + 1], "%d,%d,%d,%d", &opt.filter[0], &opt.filter[1], &opt.filter[2], &opt.filter[3]);
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			exit(1);
+		}
+	}
+}
+
+static void addStats(AD779XSimStats &total, const AD779XSimStats &s) {
+	total.bytes += s.bytes;
+	total.conversions += s.conversions;
+	total.dataReads += s.dataReads;
+	total.staleReads += s.staleReads;
+	total.missed += s.missed;
+	total.latency += s.latency;
+	total.statusReads += s.statusReads;
+	total.registerWrites += s.registerWrites;
+	total.calibrations += s.calibrations;
+	total.resets += s.resets;
+	total.violations += s.violations;
+}
+
+/* Reference statistics
+ *******************************************************************
+ * Welford's update in long double, the algorithm the library's exact
+ * integer moments stand in for.
+ *******************************************************************
+ */
+struct BenchStatsRef
+{
+	unsigned long count, min, max;
+	long double mean, m2;
+};
+
+static void statsPush(BenchStatsRef &f, unsigned long raw) {
+	f.min = !f.count || raw < f.min ? raw : f.min;
+	f.max = !f.count || raw > f.max ? raw : f.max;
+	f.count++;
+	long double delta = raw - f.mean;
+	f.mean += delta / f.count;
+	f.m2 += delta * (raw - f.mean);
+}
+
+/* Reference filter
+ *******************************************************************
+ * The same chain as AD779XFilter written from the definitions, with a
+ * full history and 64-bit sums: a sorted copy of the window for the
+ * median, the CIC as its impulse response (a boxcar convolved order
+ * times) applied to every R-th input, the IIR in plain arithmetic.
+ *******************************************************************
+ */
+
+#define REF_HISTORY		1024
+
+struct BenchFilterRef
+{
+	int window, order, decimation, shift;
+	unsigned long raw[REF_HISTORY], median[REF_HISTORY];
+	long long impulse[REF_HISTORY], iir;
+	unsigned long count, outputs, output;
+	int taps;
+	bool iirStarted;
+};
+
+static void refInit(BenchFilterRef &f, const int *filter) {
+	memset(&f, 0, sizeof(f));
+	f.window = filter[0] > 1 ? filter[0] : 0;
+	f.order = filter[2] > 1 ? filter[1] : 0;
+	f.decimation = f.order ? filter[2] : 1;
+	f.shift = filter[3];
+	f.impulse[0] = 1;
+	f.taps = 1;
+	for (int o = 0; o < f.order; o++) {
+		long long next[REF_HISTORY];
+		memset(next, 0, sizeof(next));
+		for (int k = 0; k < f.taps; k++) {
+			for (int j = 0; j < f.decimation; j++) {
+				next[k + j] += f.impulse[k];
+			}
+		}
+		f.taps += f.decimation - 1;
+		memcpy(f.impulse, next, sizeof(next));
+	}
+}
+
+static bool refPush(BenchFilterRef &f, unsigned long raw) {
+	unsigned long n = f.count++;
+	f.raw[n % REF_HISTORY] = raw;
+	unsigned long x = raw;
+	if (f.window) {
+		unsigned long sorted[256];
+		int m = n + 1 < (unsigned long)f.window ? n + 1 : f.window;
+		for (int i = 0; i < m; i++) {
+			sorted[i] = f.raw[(n - i) % REF_HISTORY];
+		}
+		for (int i = 1; i < m; i++) {
+			for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+				unsigned long t = sorted[j];
+				sorted[j] = sorted[j - 1];
+				sorted[j - 1] = t;
+			}
+		}
+		x = sorted[m / 2];
+	}
+	f.median[n % REF_HISTORY] = x;
+	if (f.order) {
+		if ((n + 1) % f.decimation) {
+			return false;
+		}
+		if ((n + 1) / f.decimation < (unsigned long)f.order) {		// first order - 1 outputs lack a full history
+			return false;
+		}
+		long long sum = 0, gain = 1;
+		for (int k = 0; k < f.taps && k <= (long)n; k++) {
+			sum += f.impulse[k] * f.median[(n - k) % REF_HISTORY];
+		}
+		for (int o = 0; o < f.order; o++) {
+			gain *= f.decimation;
+		}
+		x = sum / gain;
+	}
+	if (f.shift) {
+		if (!f.iirStarted) {
+			f.iir = (long long)x << f.shift;
+			f.iirStarted = true;
+		}
+		f.iir += (long long)x - (f.iir >> f.shift);
+		x = f.iir >> f.shift;
+	}
+	f.output = x;
+	f.outputs++;
+	return true;
+}
+
+static unsigned long traceDrain(AD779XTrace &trace, FILE *f) {	// the capture as a sketch would stream it out
+	unsigned char buf[256];
+	unsigned long total = 0;
+	unsigned int n;
+	while (f && (n = trace.drain(buf, sizeof(buf)))) {
+		fwrite(buf, 1, n, f);
+		total += n;
+	}
+	return total;
+}
+
+static void exportBatch(AD779XExport &exporter, Print &out, AD779XSample *pending, unsigned int &count) {
+	for (unsigned int k = 0; k < count; ) {
+		k += exporter.write(out, pending + k, count - k > 255 ? 255 : count - k);
+	}
+	count = 0;
+}
+
+static void loadCalibration(AD779X &adc, const char *path) {
+	unsigned char blob[AD779X_CAL_BLOB_SIZE];
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return;
+	}
+	size_t n = fread(blob, 1, sizeof(blob), f);
+	fclose(f);
+	if (!adc.loadCalibration(blob, n)) {
+		fprintf(stderr, "%s: not a calibration blob for this part\n", path);
+	}
+}
+
+static void saveCalibration(AD779X &adc, const char *path) {
+	unsigned char blob[AD779X_CAL_BLOB_SIZE];
+	unsigned int n = adc.saveCalibration(blob, sizeof(blob));
+	FILE *f = fopen(path, "wb");
+	if (f) {
+		fwrite(blob, 1, n, f);
+		fclose(f);
+	}
+}
+
+int main(int argc, char **argv) {
+	BenchOptions opt = {7799, 3, 7, 9, 32, -1, 0, 0, 1, {-1, -1, -1}, 10, 100, 0, 1.0, 0, {-1, 0, 1, 0}, 0, 0, 0, 0, 0, {0, 0, 0}, 0, 0, {-1, -1}, 0, 0, 0, 0};
+	parseOptions(argc, argv, opt);
+	if ((opt.traceOut && !AD779X_TRACE) || (opt.async && !AD779X_ASYNC)) {
+		fprintf(stderr, "--trace-out needs AD779X_TRACE and --async AD779X_ASYNC, this build has them off\n");
+		return 1;
+	}
+	AD779XReplay replay;
+	if (opt.replay) {
+		if (!replay.load(opt.replay)) {
+			fprintf(stderr, "%s: not an AD779XTrace capture\n", opt.replay);
+			return 1;
+		}
+		opt.model = replay.model();							// the captured session, then the options given again on top
+		opt.rate = replay.rate() > 0 ? replay.rate() : opt.rate;
+		opt.continuous = replay.continuous();
+		for (int i = 0; i < 3; i++) {
+			if (replay.count(i)) {
+				opt.channels = i + 1;
+				opt.gains[i] = replay.gain(i);
+			}
+		}
+		opt.gain = opt.gains[0] >= 0 ? opt.gains[0] : opt.gain;
+		parseOptions(argc, argv, opt);
+	}
+	unsigned char sequence[AD779X_SLOTS];
+	int slots = 0;
+	for (const char *p = opt.sequence; p && *p && slots < AD779X_SLOTS; p = strchr(p, ',') ? strchr(p, ',') + 1 : "") {
+		sequence[slots++] = atoi(p);
+	}
+	if (slots || opt.weights[0] || opt.weights[1] || opt.weights[2]) {	// readings printed for every channel the table reaches
+		opt.channels = 1;
+		for (int i = 0; i < slots; i++) {
+			opt.channels = sequence[i] >= opt.channels ? sequence[i] + 1 : opt.channels;
+		}
+		for (int i = 0; i < 3 && !slots; i++) {
+			opt.channels = opt.weights[i] ? i + 1 : opt.channels;
+		}
+	}
+	double fullScale[3], input[3];
+	for (int i = 0; i < 3; i++) {
+		if (opt.gains[i] < 0) {
+			opt.gains[i] = opt.gain;
+		}
+		fullScale[i] = BENCH_VREF / (1 << opt.gains[i]);
+		input[i] = opt.steps ? BENCH_VREF * benchLevels[i] : fullScale[i] * (i + 1) / 4;	// 25%, 50% and 75% of the range
+	}
+	if (opt.devices < 1 || opt.devices > AD779X_BUS_DEVICES || (opt.devices > 1 && (opt.irqPin >= 0 || opt.filter[0] >= 0 || opt.stats || opt.autorange[0] >= 0 || opt.faultEvery || opt.replay))) {
+		fprintf(stderr, "--devices must be 1..%d, and 1 with --irq-pin, --filter, --stats, --autorange, --fault-every or --replay\n", AD779X_BUS_DEVICES);
+		return 1;
+	}
+
+	hostReset();
+	AD779XSim *chip[AD779X_BUS_DEVICES];
+	for (int d = 0; d < opt.devices; d++) {
+		chip[d] = new AD779XSim(opt.model == 7799);
+		chip[d]->setReference(BENCH_VREF, !opt.noRef);
+		chip[d]->setClockScale(opt.clockScale);
+		chip[d]->setNoise(opt.noise);
+		for (int i = 0; i < 3; i++) {
+			chip[d]->setInput(i, input[i]);
+			if (opt.faultEvery) {
+				chip[d]->setOffsetError(i, fullScale[i] * (i + 1) / 100);	// 1%, 2% and 3% of the range
+			}
+		}
+		for (int g = 0; g < 8 && opt.faultEvery; g++) {
+			chip[d]->setGainError(g, 0.005);
+		}
+		hostAttach(chip[d], BENCH_CS_PIN + d);
+	}
+	if (opt.replay) {
+		replay.apply(*chip[0]);
+	}
+	if (opt.irqPin >= 0) {
+		hostMirrorMiso(opt.irqPin);
+	}
+
+	AD779XMockEngine engine;								// after hostReset()
+	if (opt.async) {
+		hostAttach(&engine, BENCH_ENGINE_PIN);
+	}
+
+	SPI.begin();
+
+	AD779X *adc[AD779X_BUS_DEVICES];
+	AD779XBus bus;
+	AD779XSample ringBuffer[128], drained[128];
+	bool filtering = opt.filter[0] >= 0;
+	if ((filtering || opt.stats || opt.exportPath) && !opt.ring) {
+		opt.ring = 32;										// the reference and the export see the samples through the ring
+	}
+	AD779XExport exporter;
+	AD779XExportDecoder decoder;
+	BenchSink sink(decoder);
+	AD779XSample *exported = 0;
+	unsigned long exportedSize = 0, textBytes = 0, ringLost = 0;
+	AD779XSample pending[BENCH_EXPORT_BATCH + 128];
+	unsigned int pendingCount = 0;
+	AD779XRing ring(ringBuffer, opt.ring ? opt.ring : 2);
+	AD779XFilter filter[3];
+	unsigned long medianBuffer[3][2*255];
+	BenchFilterRef *ref = new BenchFilterRef[3];
+	unsigned long filterOutputs = 0, filterMismatches = 0;
+	AD779XStats stats[3], window[3], total[3];
+	BenchStatsRef statsRef[3];
+	unsigned long windows = 0;
+	memset(statsRef, 0, sizeof(statsRef));
+	unsigned char *traceBuffer = new unsigned char[BENCH_TRACE_SIZE];
+	AD779XTrace trace(traceBuffer, BENCH_TRACE_SIZE);
+	FILE *traceFile = 0;
+	unsigned long traceBytes = 0;
+	if (opt.traceOut && !(traceFile = fopen(opt.traceOut, "wb"))) {
+		fprintf(stderr, "%s: cannot write\n", opt.traceOut);
+		return 1;
+	}
+	for (int i = 0; i < 3 && filtering; i++) {
+		if (!filter[i].median(medianBuffer[i], opt.filter[0]) || !filter[i].cic(opt.filter[1], opt.filter[2]) || !filter[i].iir(opt.filter[3])) {
+			fprintf(stderr, "--filter: median window odd, R^order <= %d, IIR shift <= 8\n", AD779X_CIC_GAIN);
+			return 1;
+		}
+		refInit(ref[i], opt.filter);
+	}
+	unsigned long long t0 = hostNow();
+	for (int d = 0; d < opt.devices; d++) {
+		adc[d] = new AD779X(BENCH_VREF);
+		adc[d]->SPIClock(16000000UL / opt.clockDiv);
+		adc[d]->Begin(BENCH_CS_PIN + d, opt.irqPin);
+		#if AD779X_TRACE
+			if (traceFile && d == 0) {
+				adc[d]->attachTrace(&trace);
+			}
+		#endif
+		#if AD779X_ASYNC
+			if (opt.async) {
+				adc[d]->attachEngine(&engine);
+			}
+		#endif
+		if (slots) {
+			if (!adc[d]->Sequence(sequence, slots)) {
+				fprintf(stderr, "--sequence: up to %d slots of channels 0..2\n", AD779X_SLOTS);
+				return 1;
+			}
+		}
+		else if (opt.weights[0] || opt.weights[1] || opt.weights[2]) {
+			if (!adc[d]->Schedule(opt.weights[0], opt.weights[1], opt.weights[2])) {
+				fprintf(stderr, "--weights: up to %d slots in total\n", AD779X_SLOTS);
+				return 1;
+			}
+		}
+		else {
+			adc[d]->Setup(opt.channels, 0, 1, 2);
+		}
+		if (opt.calFile && d == 0) {
+			loadCalibration(*adc[d], opt.calFile);
+		}
+		adc[d]->Config(opt.gain, 1, opt.rate, 1, opt.noRef);
+		for (int i = 0; i < 3; i++) {
+			if (opt.gains[i] != opt.gain) {
+				adc[d]->ConfigChannel(i, opt.gains[i]);
+			}
+		}
+		adc[d]->Continuous(opt.continuous);
+		if (opt.ring) {
+			adc[d]->attachRing(&ring);
+		}
+		for (int i = 0; i < 3 && filtering; i++) {
+			adc[d]->attachFilter(i, &filter[i]);
+		}
+		for (int i = 0; i < 3 && opt.stats; i++) {
+			adc[d]->attachStats(i, &stats[i]);
+		}
+		for (int i = 0; i < 3 && opt.autorange[0] >= 0; i++) {
+			if (!adc[d]->AutoRange(i, 1, opt.autorange[0], opt.autorange[1]) && d == 0) {
+				fprintf(stderr, "channel %d: %d cache entries can't hold another range, its gain stays fixed\n", i, AD779X_CAL_ENTRIES);
+			}
+		}
+		bus.add(adc[d]);
+	}
+	unsigned long long setupCallUs = hostNow() - t0, longestUs = 0;
+	bool ready = false;
+	while (!ready) {										// reset, configuration and calibration run from Update()
+		ready = true;
+		for (int d = 0; d < opt.devices; d++) {
+			unsigned long long t = hostNow();
+			adc[d]->Update();
+			if (hostNow() - t > longestUs) {
+				longestUs = hostNow() - t;
+			}
+			ready = ready && adc[d]->State() == AD779X_READY;
+		}
+		traceBytes += traceDrain(trace, traceFile);
+		hostAdvance(opt.loopUs ? opt.loopUs : 1);
+	}
+	unsigned long long setupUs = hostNow() - t0;
+	if (opt.calFile) {
+		saveCalibration(*adc[0], opt.calFile);
+	}
+	unsigned long long setupCalibrations = chip[0]->stats().calibrations;
+
+	hostClearStats();
+	for (int d = 0; d < opt.devices; d++) {
+		chip[d]->clearStats();
+		#if AD779X_TELEMETRY
+			adc[d]->clearTelemetry();
+		#endif
+	}
+	if (opt.stats) {										// the reference starts from the first sample queued from now on
+		ring.drain(drained, 128);
+		for (int i = 0; i < 3; i++) {
+			stats[i].clear();
+		}
+	}
+	t0 = hostNow();
+	unsigned long long nextWindow = t0 + 1000000ULL;
+	unsigned long long nextStep = t0 + opt.steps * 1000ULL;
+	unsigned long long nextIO = t0 + opt.setIO * 1000ULL;
+	unsigned long long nextStatus = t0 + opt.status * 1000ULL;
+	unsigned long ioWrites = 0, statusCalls = 0, statusErrors = 0;
+	unsigned long inputSteps = 0, rangeChecked = 0, rangeSeq[3] = {0, 0, 0}, gainSamples[3][8];
+	unsigned char settled[3] = {0, 0, 0};
+	double rangeError = 0;
+	memset(gainSamples, 0, sizeof(gainSamples));
+	unsigned long long end = t0 + opt.seconds * 1000000ULL;
+	unsigned long samples = 0, passes = 0, queued = 0;
+	unsigned long long nextFault = t0 + opt.faultEvery * 1000ULL, faultAt = 0, detectedAt = 0;
+	unsigned long long outageMax = 0, outageSum = 0, recoveryMax = 0, recoverySum = 0;
+	unsigned long faults = 0, recovered = 0, drifted = 0, expected[3];
+	AD779XSnapshot snapshot;
+	unsigned long snapshots = 0, snapshotPass = 0, snapshotSeq = 0, snapshotsSkipped = 0, snapshotsMixed = 0, snapshotSpread = 0;
+	bool reference = false;
+	unsigned int failures = adc[0]->adcFail;
+	struct timespec cpu0, cpu1;
+	unsigned long long cpuNs = 0, updateUs = 0;
+	while (hostNow() < end) {
+		unsigned long long t = hostNow();
+		if (opt.faultEvery && t >= nextFault && !faultAt) {
+			for (int i = 0; i < opt.channels; i++) {		// readings since the last recovery against those before the first fault
+				long diff = (long)(adc[0]->readRaw(i) - expected[i]);
+				if (!reference) {
+					expected[i] = adc[0]->readRaw(i);
+				}
+				else if (diff > 2 + 6*opt.noise || diff < -2 - 6*opt.noise) {
+					drifted++;
+				}
+			}
+			reference = reference || samples >= (unsigned long)opt.channels;
+			chip[0]->hang();
+			faultAt = t;
+			faults++;
+			nextFault += opt.faultEvery * 1000ULL;
+		}
+		if (opt.steps && t >= nextStep) {
+			inputSteps++;
+			for (int i = 0; i < 3; i++) {
+				input[i] = BENCH_VREF * benchLevels[(inputSteps + i) % BENCH_LEVELS];
+				chip[0]->setInput(i, input[i]);
+				settled[i] = 0;
+			}
+			nextStep += opt.steps * 1000ULL;
+		}
+		if (opt.setIO && t >= nextIO) {						// P1/P2 switched by the sketch while conversions run
+			ioWrites++;
+			for (int d = 0; d < opt.devices; d++) {
+				adc[d]->setIO(ioWrites & 1 ? 0x40 : 0x00);
+			}
+			nextIO += opt.setIO * 1000ULL;
+		}
+		if (opt.status && t >= nextStatus) {
+			statusCalls++;
+			statusErrors += (adc[0]->StatusReg() & 0x40) != 0;
+			nextStatus += opt.status * 1000ULL;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &cpu0);
+		bool sampled = opt.devices == 1 && adc[0]->Update();
+		if (opt.devices > 1) {
+			while (bus.Update() >= 0) {						// serve every chip that is ready
+				samples++;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &cpu1);
+		cpuNs += (cpu1.tv_sec - cpu0.tv_sec) * 1000000000ULL + cpu1.tv_nsec - cpu0.tv_nsec;
+		updateUs += hostNow() - t;
+		if (sampled) {
+			samples++;
+			if (faultAt && detectedAt) {					// first sample after the recovery
+				t = hostNow();
+				outageMax = t - faultAt > outageMax ? t - faultAt : outageMax;
+				outageSum += t - faultAt;
+				recoveryMax = t - detectedAt > recoveryMax ? t - detectedAt : recoveryMax;
+				recoverySum += t - detectedAt;
+				recovered++;
+				faultAt = 0;
+				detectedAt = 0;
+			}
+		}
+		for (int i = 0; i < opt.channels && opt.autorange[0] >= 0 && sampled; i++) {	// readmV() against the input, two results after a step
+			AD779XSample sample;
+			unsigned long seq = adc[0]->readSample(i, sample);
+			if (seq == rangeSeq[i]) {
+				continue;
+			}
+			rangeSeq[i] = seq;
+			gainSamples[i][sample.gain & 0x07]++;
+			if (settled[i] < 2) {
+				settled[i]++;
+				continue;
+			}
+			if (sample.raw == 0 || sample.raw == (opt.model == 7799 ? 0xFFFFFFUL : 0xFFFFUL)) {	// clipped: the switch is still in the pipeline
+				continue;
+			}
+			double lsb = BENCH_VREF * 1000 / (1 << sample.gain) / (opt.model == 7799 ? 16777216.0 : 65536.0);	// mV, unipolar
+			double error = fabs(adc[0]->readmV(i) - input[i] * 1000) / lsb;
+			rangeError = error > rangeError ? error : rangeError;
+			rangeChecked++;
+		}
+		if (opt.devices == 1 && adc[0]->snapshot(snapshot) && snapshot.pass != snapshotPass) {	// every channel newer than the last pass read
+			unsigned long first = 0, last = 0, newest = snapshotSeq;
+			bool mixed = false;
+			for (int i = 0; i < 3; i++) {
+				if (!(snapshot.channels & (1 << i))) {
+					continue;
+				}
+				mixed = mixed || snapshot.seq[i] <= snapshotSeq;
+				newest = snapshot.seq[i] > newest ? snapshot.seq[i] : newest;
+				first = !first || snapshot.timestamp[i] < first ? snapshot.timestamp[i] : first;
+				last = snapshot.timestamp[i] > last ? snapshot.timestamp[i] : last;
+			}
+			snapshotsSkipped += snapshotPass ? snapshot.pass - snapshotPass - 1 : 0;
+			snapshotsMixed += mixed;
+			snapshotSpread = last - first > snapshotSpread ? last - first : snapshotSpread;
+			snapshotPass = snapshot.pass;
+			snapshotSeq = newest;
+			snapshots++;
+		}
+		if (faultAt && !detectedAt && adc[0]->adcFail != failures) {
+			detectedAt = hostNow();
+		}
+		failures = adc[0]->adcFail;
+		if (hostNow() - t > longestUs) {
+			longestUs = hostNow() - t;
+		}
+		if (opt.ring) {
+			unsigned char n = ring.drain(drained, 128);
+			queued += n;
+			for (unsigned char k = 0; k < n && filtering; k++) {
+				refPush(ref[drained[k].channel], drained[k].raw);
+			}
+			for (unsigned char k = 0; k < n && opt.stats; k++) {
+				statsPush(statsRef[drained[k].channel], drained[k].raw);
+			}
+			if (opt.exportPath) {
+				exporter.lost(ring.overflows() - ringLost);	// shows as a gap in the sequence numbers
+				ringLost = ring.overflows();
+				memcpy(pending + pendingCount, drained, n * sizeof(AD779XSample));
+				pendingCount += n;
+				if (pendingCount >= BENCH_EXPORT_BATCH) {		// a sketch sends when a frame's worth is queued
+					exportBatch(exporter, sink, pending, pendingCount);
+				}
+				exported = (AD779XSample *)realloc(exported, (exportedSize + n) * sizeof(AD779XSample));
+				memcpy(exported + exportedSize, drained, n * sizeof(AD779XSample));
+				exportedSize += n;
+				for (unsigned char k = 0; k < n; k++) {		// what the buffered example prints for the sample
+					char line[64];
+					textBytes += snprintf(line, sizeof(line), "%lu\tCH%u\tRAW: %lX\r\n", drained[k].timestamp, drained[k].channel, drained[k].raw);
+				}
+			}
+		}
+		for (int i = 0; i < 3 && filtering; i++) {
+			unsigned char n = filter[i].available();
+			if (n) {
+				filterOutputs += n;
+				if (filter[i].read() != ref[i].output) {
+					filterMismatches++;
+				}
+			}
+		}
+		if (opt.stats && hostNow() >= nextWindow) {			// what a sketch reporting its noise once a second does
+			for (int i = 0; i < 3; i++) {
+				stats[i].take(window[i]);
+				total[i].merge(window[i]);
+			}
+			windows++;
+			nextWindow += 1000000ULL;
+		}
+		traceBytes += traceDrain(trace, traceFile);
+		passes++;
+		hostAdvance(opt.loopUs ? opt.loopUs : 1);
+	}
+	double elapsed = (hostNow() - t0) / 1e6;
+	unsigned long failed = 0;								// checks that went wrong, the exit status
+	if (opt.async) {
+		engine.wait();										// a burst still shifting would count on the bus only
+	}
+	for (unsigned char k = 0, n = opt.stats ? ring.drain(drained, 128) : 0; k < n; k++) {	// what the ring still holds
+		statsPush(statsRef[drained[k].channel], drained[k].raw);
+	}
+	for (int i = 0; i < 3 && opt.stats; i++) {				// and the partial window
+		AD779XStats rest;
+		stats[i].take(rest);
+		total[i].merge(rest);
+	}
+
+	AD779XSimStats s;
+	memset(&s, 0, sizeof(s));
+	for (int d = 0; d < opt.devices; d++) {
+		addStats(s, chip[d]->stats());
+	}
+	const HostBusStats &b = hostStats();
+	double perSample = samples ? 1.0 / samples : 0;
+	printf("model           %d x AD%d, %d channel(s), gain code %d, rate code %d, %s%s, %s\n", opt.devices, opt.model, opt.channels, opt.gain, opt.rate, opt.irqPin >= 0 ? "interrupt" : "polling", opt.continuous ? ", continuous" : "", BENCH_STRING(AD779X_TRANSPORT));
+	printf("setup           %.3f ms until ready (%.3f ms in the setup calls), %llu calibrations\n", setupUs / 1e3, setupCallUs / 1e3, setupCalibrations);
+	printf("longest call    %.3f ms in one Update(), %.1f us per sample in all of them\n", longestUs / 1e3, updateUs * perSample);
+	printf("conversion      %lu us\n", chip[0]->conversionTime());
+	printf("samples         %lu in %.3f s (%.2f/s)\n", samples, elapsed, samples / elapsed);
+	printf("loop passes     %lu\n", passes);
+	printf("host cpu        %.0f ns per loop pass in Update(), %.0f ns per sample\n", passes ? (double)cpuNs / passes : 0.0, samples ? (double)cpuNs / samples : 0.0);
+	if (opt.replay) {
+		const AD779XReplayStats &r = replay.stats();
+		double perRead = r.dataReads ? 1.0 / r.dataReads : 0;
+		printf("replay          %s: %.3f s captured, %lu/%lu/%lu codes, %lu gaps, %lu resets\n", opt.replay, r.duration / 1e6, replay.count(0), replay.count(1), replay.count(2), r.gaps, r.resets);
+		printf("captured cost   %.2f spi bytes, %.2f frames, %.2f cs selects, %.2f status polls per sample (%.2f samples/s)\n", r.bytes * perRead, r.frames * perRead, r.selects * perRead, r.statusReads * perRead, r.duration ? r.dataReads * 1e6 / r.duration : 0.0);
+	}
+	if (opt.exportPath) {
+		exportBatch(exporter, sink, pending, pendingCount);
+		const AD779XExportStats &e = decoder.stats();
+		double perExported = exportedSize ? 1.0 / exportedSize : 0;
+		printf("export          %lu frames in %lu writes, %.2f bytes/sample framed, %.2f as text (%.0f samples/s at 115200 baud)\n", e.frames, sink.writes, sink.bytes * perExported, textBytes * perExported, sink.bytes ? exportedSize * 11520.0 / sink.bytes : 0.0);
+		AD779XColumns columns;
+		unsigned long mismatches = 0;
+		if (!decoder.save(opt.exportPath) || !columns.map(opt.exportPath)) {
+			printf("export file     %s: cannot write or map\n", opt.exportPath);
+			failed++;
+		}
+		else {
+			for (unsigned long k = 0; k < exportedSize && k < columns.count(); k++) {
+				if (columns.raw()[k] != exported[k].raw || columns.channel()[k] != exported[k].channel || (uint32_t)columns.timestamp()[k] != exported[k].timestamp || (columns.status()[k] ^ exported[k].status) & 0x60 || columns.gain()[k] != exported[k].gain) {
+					mismatches++;
+				}
+			}
+			mismatches += exportedSize > columns.count() ? exportedSize - columns.count() : 0;
+			printf("export file     %s: %llu samples mapped, %lu mismatches, %lu lost, %lu CRC errors\n", opt.exportPath, (unsigned long long)columns.count(), mismatches, e.lost, e.crcErrors);
+			failed += mismatches || e.crcErrors;
+		}
+		free(exported);
+	}
+	if (traceFile) {
+		printf("trace out       %s: %lu bytes (%.2f/sample), %lu records dropped\n", opt.traceOut, traceBytes, samples ? (double)traceBytes / samples : 0.0, trace.overflows());
+		fclose(traceFile);
+	}
+	if (snapshots) {
+		printf("snapshots       %lu passes read, %lu skipped, %lu mixing passes, %lu us max spread within a pass\n", snapshots, snapshotsSkipped, snapshotsMixed, snapshotSpread);
+		failed += snapshotsMixed != 0;
+	}
+	if (opt.ring) {
+		printf("ring            %lu drained, %lu overflows\n", queued, ring.overflows());
+	}
+	if (filtering) {
+		unsigned long refOutputs = ref[0].outputs + ref[1].outputs + ref[2].outputs;
+		printf("filter          median %d, CIC order %d / %d, IIR 1/%d: %lu outputs (%lu reference), %lu mismatches\n", opt.filter[0], opt.filter[1], opt.filter[2], 1 << opt.filter[3], filterOutputs, refOutputs, filterMismatches);
+		failed += filterMismatches || filterOutputs != refOutputs;
+		for (int i = 0; i < opt.channels; i++) {
+			printf("ch%d filtered    raw 0x%06lX\n", i, filter[i].read());
+		}
+	}
+	if (opt.stats) {
+		unsigned long mismatches = 0;
+		double meanError = 0, varianceError = 0;
+		for (int i = 0; i < 3; i++) {
+			const BenchStatsRef &f = statsRef[i];
+			long double mean = f.mean;
+			long double variance = f.count > 1 ? f.m2 / (f.count - 1) : 0;
+			mismatches += total[i].count() != f.count || (f.count && (total[i].min() != f.min || total[i].max() != f.max));
+			double e = fabs((double)(total[i].mean() - mean));
+			meanError = e > meanError ? e : meanError;
+			e = variance > 0 ? fabs((double)(total[i].variance() / variance - 1)) : total[i].variance();
+			varianceError = e > varianceError ? e : varianceError;
+		}
+		printf("stats check     %lu windows merged, %lu count/min/max mismatches, mean %.2g LSB and variance %.2g relative off the reference\n", windows, mismatches, meanError, varianceError);
+		failed += mismatches != 0;
+		for (int i = 0; i < opt.channels; i++) {
+			printf("ch%d stats       %lu samples, mean 0x%06lX, rms %.3f LSB (%.3f uV), p-p %lu LSB, %.2f effective / %.2f noise-free bits\n", i, total[i].count(), (unsigned long)(total[i].mean() + 0.5), total[i].rms(), total[i].rmsuV(), total[i].peakToPeak(), total[i].effectiveBits(), total[i].noiseFreeBits());
+		}
+	}
+	if (opt.autorange[0] >= 0) {
+		#if AD779X_TELEMETRY
+			const AD779XTelemetry &t = adc[0]->telemetry();
+			printf("autorange       gains %d..%d, %lu input steps, %lu switches, %lu ERR samples, readmV() within %.1f LSB of the input in %lu settled samples\n", opt.autorange[0], opt.autorange[1], inputSteps, t.rangeChanges, t.errors, rangeError, rangeChecked);
+		#else
+			printf("autorange       gains %d..%d, %lu input steps, readmV() within %.1f LSB of the input in %lu settled samples\n", opt.autorange[0], opt.autorange[1], inputSteps, rangeError, rangeChecked);
+		#endif
+		failed += rangeError > 1;							// half an LSB of quantization, the rest float rounding
+		for (int i = 0; i < opt.channels; i++) {
+			printf("ch%d gains       ", i);
+			for (int g = 0; g < 8; g++) {
+				if (gainSamples[i][g]) {
+					printf(" x%d:%lu", 1 << g, gainSamples[i][g]);
+				}
+			}
+			printf("\n");
+		}
+	}
+	printf("spi bytes       %llu (%.2f/sample)\n", b.bytes, b.bytes * perSample);
+	printf("spi transfers   %llu (%.2f/sample)\n", b.transfers, b.transfers * perSample);
+	if (opt.async) {
+		const AD779XMockEngineStats &e = engine.stats();
+		printf("async engine    %llu bursts (%.2f/sample), %.1f us of bus time each off the CPU\n", e.transfers, e.transfers * perSample, e.transfers ? e.busyNs / 1e3 / e.transfers : 0.0);
+		printf("async checks    %llu out of order, %llu overlapping, %llu framing errors, %llu foreign bytes\n", e.orderErrors, e.overlaps, e.framingErrors, e.foreignBytes);
+		failed += e.orderErrors || e.overlaps || e.framingErrors || e.foreignBytes;
+	}
+	printf("interrupts      %llu (%llu spurious edges)\n", b.interrupts, b.spuriousEdges);
+	printf("cs selects      %llu (%.2f/sample)\n", b.csEdges, b.csEdges * perSample);
+	printf("status polls    %llu (%.2f/sample)\n", s.statusReads, s.statusReads * perSample);
+	printf("ready checks    %llu (%.2f/sample)\n", b.pinReads, b.pinReads * perSample);
+	printf("register writes %llu (%.2f/sample)\n", s.registerWrites, s.registerWrites * perSample);
+	#if AD779X_TELEMETRY
+		const AD779XTelemetry &t = adc[0]->telemetry();
+		unsigned long tSamples = t.samples[0] + t.samples[1] + t.samples[2];
+		if (tSamples) {
+			printf("shadow          %.2f write bytes/sample sent, %.2f saved, %lu cached reads\n", (double)t.writeBytes / tSamples, (double)t.savedBytes / tSamples, t.cachedReads);
+		}
+		printf("telemetry       samples %lu/%lu/%lu, not ready %lu, timeouts %lu, ERR %lu, NOREF %lu, resets %lu, calibrations %lu\n", t.samples[0], t.samples[1], t.samples[2], t.notReady, t.timeouts, t.errors, t.noRef, t.resets, t.calibrations);
+		if (slots || opt.weights[0] || opt.weights[1] || opt.weights[2]) {
+			printf("scan            %.2f/%.2f/%.2f samples/s on channel 0/1/2\n", t.samples[0] / elapsed, t.samples[1] / elapsed, t.samples[2] / elapsed);
+		}
+		printf("telemetry spi   %lu sent, %lu received (%s the bus count)\n", t.spiSent, t.spiReceived, opt.devices > 1 ? "first chip," : t.spiSent + t.spiReceived == b.bytes ? "matches" : "DIFFERS from");
+		failed += opt.devices == 1 && t.spiSent + t.spiReceived != b.bytes;
+		printf("latency         ");
+		for (int i = 0; i < AD779X_LATENCY_BINS; i++) {
+			if (t.latency[i]) {
+				printf(" <%luus:%lu", 1UL << i, t.latency[i]);
+			}
+		}
+		printf("\n");
+	#endif
+	printf("conversions     %llu, read %llu, stale reads %llu, missed %llu\n", s.conversions, s.dataReads, s.staleReads, s.missed);
+	printf("read latency    %.1f us/sample\n", s.dataReads > s.staleReads ? (double)s.latency / (s.dataReads - s.staleReads) : 0.0);
+	printf("resets          %llu (%llu bytes inside the 500us recovery)\n", s.resets, s.violations);
+	printf("adcFail         %u\n", adc[0]->adcFail);
+	failed += !opt.faultEvery && !opt.replay && adc[0]->adcFail;	// a timeout nothing provoked
+	if (opt.setIO) {
+		printf("io writes       %lu setIO() calls\n", ioWrites);
+	}
+	if (opt.status) {
+		printf("status reads    %lu StatusReg() calls, %lu with ERR\n", statusCalls, statusErrors);
+	}
+	if (opt.faultEvery) {
+		#if AD779X_TELEMETRY
+			printf("faults          %lu injected, %lu recovered, %lu replays (%lu not read back), %lu drifted readings\n", faults, recovered, adc[0]->telemetry().recoveries, adc[0]->telemetry().recoveryFailures, drifted);
+		#else
+			printf("faults          %lu injected, %lu recovered, %lu drifted readings\n", faults, recovered, drifted);
+		#endif
+		printf("outage          %.3f ms max, %.3f ms average from the hang to the next sample\n", outageMax / 1e3, recovered ? outageSum / 1e3 / recovered : 0.0);
+		failed += faults > recovered + (faultAt != 0);		// the last one may still be recovering
+		printf("recovery        %.3f ms max, %.3f ms average from the timeout to the next sample (%.1f conversions)\n", recoveryMax / 1e3, recovered ? recoverySum / 1e3 / recovered : 0.0, recovered ? (double)recoverySum / recovered / chip[0]->conversionTime() : 0.0);
+	}
+	for (int i = 0; i < opt.channels; i++) {
+		printf("ch%d             raw 0x%06lX  %.4f mV  %ld uV  %ld nV (input %.4f mV)\n", i, adc[0]->readRaw(i), adc[0]->readmV(i), adc[0]->readuV(i), adc[0]->readnV(i), input[i] * 1000);
+	}
+	if (failed) {
+		fprintf(stderr, "%lu check(s) failed\n", failed);
+		return 1;
+	}
+	return 0;
+}
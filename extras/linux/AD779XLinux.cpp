@@ -0,0 +1,98 @@
+/*************************************************************************
+* AD779X acquisition thread for Linux
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+
+#include "AD779XLinux.h"
+
+AD779XLinux::AD779XLinux() {
+	_running = false;
+	_started = false;
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+AD779XLinux::~AD779XLinux() {
+	stop();
+}
+
+bool AD779XLinux::add(AD779X *adc) {
+	return !_started && _bus.add(adc);
+}
+
+bool AD779XLinux::start(int priority) {
+	if (_started) {
+		return false;
+	}
+	memset(&_stats, 0, sizeof(_stats));
+	_running = true;
+	if (priority > 0) {
+		pthread_attr_t attr;
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		pthread_attr_init(&attr);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+		_stats.realtime = pthread_create(&_thread, &attr, entry, this) == 0;
+		pthread_attr_destroy(&attr);
+		_started = _stats.realtime;
+	}
+	if (!_started) {								// no CAP_SYS_NICE or RLIMIT_RTPRIO: run anyway
+		_started = pthread_create(&_thread, 0, entry, this) == 0;
+	}
+	_running = _started;
+	return _started;
+}
+
+void AD779XLinux::stop() {
+	if (!_started) {
+		return;
+	}
+	_running = false;
+	pthread_join(_thread, 0);
+	_started = false;
+}
+
+void *AD779XLinux::entry(void *self) {
+	((AD779XLinux *)self)->run();
+	return 0;
+}
+
+void AD779XLinux::run() {
+	struct timespec wake, now;
+	clock_gettime(CLOCK_MONOTONIC, &wake);
+	while (_running) {
+		while (_bus.Update() >= 0) {				// every chip that is ready, one message each
+			_stats.samples++;
+		}
+		long sleep = AD779X_LINUX_MAX_SLEEP;
+		for (unsigned char i = 0; i < _bus.devices(); i++) {
+			long due = _bus.device(i)->due();
+			sleep = due < sleep ? due : sleep;
+		}
+		sleep = sleep < AD779X_LINUX_MIN_SLEEP ? AD779X_LINUX_MIN_SLEEP : sleep;
+		clock_gettime(CLOCK_MONOTONIC, &wake);
+		wake.tv_nsec += sleep * 1000L;
+		while (wake.tv_nsec >= 1000000000L) {
+			wake.tv_nsec -= 1000000000L;
+			wake.tv_sec++;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, 0) == EINTR) {	// a signal: sleep on to the same time
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		unsigned long long late = ((now.tv_sec - wake.tv_sec) * 1000000000LL + now.tv_nsec - wake.tv_nsec) / 1000;
+		_stats.lateUs = late > _stats.lateUs ? late : _stats.lateUs;
+		_stats.wakeups++;
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	_stats.cpuNs = now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+* AD779X acquisition thread for Linux
+*
+* Runs the Update() loop of up to AD779X_BUS_DEVICES polled chips on its
+* own thread, optionally SCHED_FIFO. Between results the thread sleeps
+* until the earliest due() of its chips, so a sample costs one wake-up,
+* one DOUT/~RDY check and one SPI_IOC_MESSAGE instead of a core spinning
+* on the bus. Samples reach consumer threads through the AD779XRing
+* attached to each chip, a lock-free single producer/single consumer
+* queue; snapshot() can be read from any thread as well. Once start()
+* has been called, only the thread calls into the chips until stop().
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef AD779X_LINUX_H
+#define AD779X_LINUX_H
+
+#include <pthread.h>
+
+#include "AD779XBus.h"
+
+#define AD779X_LINUX_MIN_SLEEP	50		// us, shortest nap while a chip is overdue or setting up
+#define AD779X_LINUX_MAX_SLEEP	10000	// us, longest, so stop() is noticed
+
+struct AD779XLinuxStats
+{
+	unsigned long long samples;
+	unsigned long long wakeups;			// sleeps that ended
+	unsigned long long cpuNs;			// CPU time used by the thread
+	unsigned long long lateUs;			// longest wake-up past the requested time
+	bool realtime;						// SCHED_FIFO was granted
+};
+
+class AD779XLinux
+{
+	public:
+		AD779XLinux();
+		~AD779XLinux();
+
+		bool add(AD779X *adc);			// before start(), false once AD779X_BUS_DEVICES are attached
+		bool start(int priority = 0);	// SCHED_FIFO priority 1..99, 0 or not permitted: the default scheduler
+		void stop();
+		const AD779XLinuxStats &stats() const { return _stats; }	// complete once stopped
+
+	private:
+		AD779XBus _bus;
+		pthread_t _thread;
+		volatile bool _running;
+		bool _started;
+		AD779XLinuxStats _stats;
+
+		static void *entry(void *self);
+		void run();
+};
+
+#endif
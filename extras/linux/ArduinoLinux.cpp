@@ -0,0 +1,297 @@
+/*************************************************************************
+* Linux spidev backend for the Arduino core
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "ArduinoHost.h"
+#include "ArduinoLinux.h"
+#include "AD779X.h"
+
+#define LINUX_PINS			64
+#define LINUX_F_CPU			16000000UL			// SPI_CLOCK_DIVn are dividers of the AVR clock
+
+SPIClass SPI;
+
+static LinuxSpi *linuxDevices[LINUX_PINS];
+static LinuxSpi *linuxSelected;						// device whose chip select is low
+static LinuxSpi *linuxHolder;						// device whose CS the controller keeps active
+static uint32_t linuxSpeed = 4000000;
+static LinuxBusStats linuxBusStats;
+
+/* LinuxSpi
+ *******************************************************************/
+
+LinuxSpi::LinuxSpi() {
+	_selected = false;
+	_held = false;
+	_release = false;
+}
+
+void LinuxSpi::select(bool selected) {
+	_selected = selected;
+	if (!selected && _held) {						// CS stays active, the next message toggles it first
+		_release = true;
+	}
+}
+
+bool LinuxSpi::send(struct spi_ioc_transfer *xfer, unsigned int n) {
+	if (linuxHolder && linuxHolder != this) {		// the kernel releases the other chip's CS before this message
+		linuxHolder->_held = false;
+		linuxHolder->_release = false;
+	}
+	bool ok = message(xfer, n);
+	linuxBusStats.messages++;
+	linuxBusStats.segments += n;
+	for (unsigned int i = 0; i < n; i++) {
+		linuxBusStats.bytes += xfer[i].len;
+	}
+	_held = ok && xfer[n - 1].cs_change;
+	_release = false;
+	linuxHolder = _held ? this : 0;
+	return ok;
+}
+
+bool LinuxSpi::transfer(uint8_t *buf, size_t count, uint32_t speed) {	// the deferred deselect, then the frame
+	struct spi_ioc_transfer xfer[2];
+	memset(xfer, 0, sizeof(xfer));
+	unsigned int n = 0;
+	if (_held && _release) {						// zero length: CS goes inactive between the two frames
+		xfer[n].cs_change = 1;
+		n++;
+		linuxBusStats.csToggles++;
+	}
+	xfer[n].tx_buf = (unsigned long)buf;
+	xfer[n].rx_buf = (unsigned long)buf;
+	xfer[n].len = count;
+	xfer[n].speed_hz = speed;
+	xfer[n].bits_per_word = 8;
+	xfer[n].cs_change = 1;							// keep the chip selected, DOUT/~RDY stays valid
+	return send(xfer, n + 1);
+}
+
+int LinuxSpi::ready(uint32_t speed) {
+	if (!_selected) {
+		return HIGH;								// nobody drives MISO, the pull-up wins
+	}
+	if (line() < 0) {								// no line: the status register, ~RDY is its MSB
+		uint8_t probe[2] = {READ_REG | STATUS_REG, STUFFIN};
+		linuxBusStats.statusProbes++;
+		return transfer(probe, 2, speed) && !(probe[1] & 0x80) ? LOW : HIGH;
+	}
+	if (!_held) {									// DOUT/~RDY only drives the line while CS is active
+		struct spi_ioc_transfer xfer;
+		memset(&xfer, 0, sizeof(xfer));
+		xfer.cs_change = 1;
+		send(&xfer, 1);
+	}
+	linuxBusStats.lineReads++;
+	return line() ? HIGH : LOW;
+}
+
+/* LinuxSpidev
+ *******************************************************************/
+
+LinuxSpidev::LinuxSpidev() {
+	_fd = -1;
+	_lineFd = -1;
+}
+
+LinuxSpidev::~LinuxSpidev() {
+	close();
+}
+
+bool LinuxSpidev::open(const char *device, const char *gpioChip, unsigned int offset) {
+	close();
+	_fd = ::open(device, O_RDWR);
+	uint8_t mode = SPI_MODE_3, bits = 8;			// datasheet p.6-7
+	uint32_t speed = AD779X_SPI_CLOCK;
+	if (_fd < 0 || ioctl(_fd, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 || ioctl(_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+		close();
+		return false;
+	}
+	if (gpioChip) {
+		int chipFd = ::open(gpioChip, O_RDONLY);
+		struct gpio_v2_line_request request;
+		memset(&request, 0, sizeof(request));
+		request.offsets[0] = offset;
+		request.num_lines = 1;
+		request.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+		strncpy(request.consumer, "ad779x", sizeof(request.consumer) - 1);
+		bool ok = chipFd >= 0 && ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &request) >= 0;
+		if (chipFd >= 0) {
+			::close(chipFd);
+		}
+		if (!ok) {
+			close();
+			return false;
+		}
+		_lineFd = request.fd;
+	}
+	return true;
+}
+
+void LinuxSpidev::close() {
+	if (_fd >= 0) {
+		::close(_fd);
+	}
+	if (_lineFd >= 0) {
+		::close(_lineFd);
+	}
+	_fd = -1;
+	_lineFd = -1;
+}
+
+bool LinuxSpidev::message(struct spi_ioc_transfer *xfer, unsigned int n) {
+	return _fd >= 0 && ioctl(_fd, SPI_IOC_MESSAGE(n), xfer) >= 0;
+}
+
+int LinuxSpidev::line() {
+	if (_lineFd < 0) {
+		return -1;
+	}
+	struct gpio_v2_line_values values;
+	values.bits = 0;
+	values.mask = 1;
+	if (ioctl(_lineFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+		return HIGH;								// read as busy, the library times out and resets
+	}
+	return values.bits & 1;
+}
+
+/* Backend interface
+ *******************************************************************/
+
+void linuxAttach(LinuxSpi *spi, uint8_t csPin) {
+	if (csPin < LINUX_PINS) {
+		linuxDevices[csPin] = spi;
+	}
+}
+
+bool AD779XStreamable(unsigned char csPin) {		// a status probe would break into a CREAD stream
+	return csPin >= LINUX_PINS || !linuxDevices[csPin] || linuxDevices[csPin]->watched();
+}
+
+const LinuxBusStats &linuxStats() {
+	return linuxBusStats;
+}
+
+void linuxClearStats() {
+	memset(&linuxBusStats, 0, sizeof(linuxBusStats));
+}
+
+unsigned long long hostNow() {						// us since an arbitrary start, as the models expect
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Arduino core
+ *******************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	if (pin >= LINUX_PINS || !linuxDevices[pin]) {
+		return;
+	}
+	linuxDevices[pin]->select(val == LOW);
+	if (val == LOW) {
+		linuxSelected = linuxDevices[pin];
+	}
+	else if (linuxSelected == linuxDevices[pin]) {
+		linuxSelected = 0;
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	if (pin == MISO) {								// DOUT/~RDY of the selected chip
+		return linuxSelected ? linuxSelected->ready(linuxSpeed) : HIGH;
+	}
+	return LOW;
+}
+
+unsigned long millis() {
+	return (unsigned long)(hostNow() / 1000);
+}
+
+unsigned long micros() {
+	return (unsigned long)hostNow();
+}
+
+void delay(unsigned long ms) {
+	delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	struct timespec t = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+	while (nanosleep(&t, &t) < 0 && errno == EINTR) {
+	}
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {	// chips are polled, see ArduinoLinux.h
+	(void)interruptNum;
+	(void)userFunc;
+	(void)mode;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+	(void)interruptNum;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+/* SPI
+ *******************************************************************/
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	linuxSpeed = settings.clock;
+}
+
+void SPIClass::endTransaction() {
+}
+
+void SPIClass::usingInterrupt(uint8_t interruptNumber) {
+	(void)interruptNumber;
+}
+
+void SPIClass::notUsingInterrupt(uint8_t interruptNumber) {
+	(void)interruptNumber;
+}
+
+void SPIClass::setClockDivider(uint8_t clockDiv) {
+	linuxSpeed = LINUX_F_CPU / clockDiv;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	if (!linuxSelected || !linuxSelected->transfer(&data, 1, linuxSpeed)) {
+		return 0xFF;
+	}
+	return data;
+}
+
+void SPIClass::transfer(void *buf, size_t count) {	// one message for the whole frame
+	if (!linuxSelected || !linuxSelected->transfer((uint8_t *)buf, count, linuxSpeed)) {
+		memset(buf, 0xFF, count);
+	}
+}
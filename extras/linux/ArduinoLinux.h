@@ -0,0 +1,95 @@
+/*************************************************************************
+* Linux spidev backend for the Arduino core
+*
+* Implements the Arduino API of extras/host/Arduino.h and SPI.h on an
+* embedded Linux SoC, so the library runs unchanged. Each chip select pin
+* is bound to a LinuxSpi, usually a LinuxSpidev on /dev/spidevB.C. What
+* the library clocks between its chip select edges goes out as one
+* SPI_IOC_MESSAGE:
+*
+*	- the frame itself is a segment, read back in place;
+*	- CS is kept active after the message (cs_change on the last
+*	  segment), so DOUT/~RDY keeps signalling the end of a conversion;
+*	- a deselect costs no syscall, it becomes a leading zero-length
+*	  segment with cs_change set, which toggles CS right before the
+*	  next frame of the same chip. A message to another chip releases
+*	  the held CS in the kernel anyway.
+*
+* DOUT/~RDY is read from a GPIO line wired to MISO when one is given
+* (GPIO character device, v2 API). Without one, a ready check is a
+* status register read, which is not possible while streaming with CREAD:
+* Continuous() then reads each result with its status instead, and
+* returns false if CREAD was asked for.
+*
+* Interrupts are not delivered: chips are polled (Begin() without an
+* interrupt pin) from one thread, see AD779XLinux, and noInterrupts()
+* does nothing. Other threads only touch what is safe against that
+* thread: AD779XRing, snapshot() and the filters' and trace's readers.
+* All LinuxSpi share one SPI controller.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef ARDUINO_LINUX_H
+#define ARDUINO_LINUX_H
+
+#include <linux/spi/spidev.h>
+
+#include "Arduino.h"
+
+struct LinuxBusStats
+{
+	unsigned long long messages;		// SPI_IOC_MESSAGE calls
+	unsigned long long segments;		// spi_ioc_transfer entries in them
+	unsigned long long bytes;			// SPI bytes clocked
+	unsigned long long csToggles;		// deselects folded into the next message
+	unsigned long long lineReads;		// DOUT/~RDY read from its GPIO line
+	unsigned long long statusProbes;	// DOUT/~RDY read as the status register, no line
+};
+
+class LinuxSpi
+{
+	public:
+		LinuxSpi();
+		virtual ~LinuxSpi() {}
+
+		void select(bool selected);									// chip select edge from digitalWrite()
+		bool transfer(uint8_t *buf, size_t count, uint32_t speed);	// full duplex, in place, one message
+		int ready(uint32_t speed);									// DOUT/~RDY level, HIGH while converting
+		virtual bool watched() { return false; }					// DOUT/~RDY has a GPIO line, CREAD is possible
+
+	protected:
+		virtual bool message(struct spi_ioc_transfer *xfer, unsigned int n) = 0;	// one SPI_IOC_MESSAGE(n)
+		virtual int line() { return -1; }							// DOUT/~RDY from its GPIO line, -1 if none
+
+	private:
+		bool _selected, _held, _release;
+
+		bool send(struct spi_ioc_transfer *xfer, unsigned int n);
+};
+
+class LinuxSpidev : public LinuxSpi
+{
+	public:
+		LinuxSpidev();
+		~LinuxSpidev();
+
+		bool open(const char *device, const char *gpioChip = 0, unsigned int offset = 0);	// e.g. "/dev/spidev0.0", DOUT/~RDY on line offset of "/dev/gpiochip0"
+		void close();
+		bool watched() { return _lineFd >= 0; }
+
+	protected:
+		bool message(struct spi_ioc_transfer *xfer, unsigned int n);
+		int line();
+
+	private:
+		int _fd, _lineFd;
+};
+
+void linuxAttach(LinuxSpi *spi, uint8_t csPin);		// the device behind a chip select pin, 0 to detach
+const LinuxBusStats &linuxStats();
+void linuxClearStats();
+
+#endif
@@ -0,0 +1,65 @@
+/*************************************************************************
+* spidev stand-in for the Linux backend
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include "LinuxFakeSpi.h"
+
+static LinuxFakeSpi *fakeHolder;					// the one chip whose CS the controller keeps active
+
+LinuxFakeSpi::LinuxFakeSpi(HostDevice *device, bool readyLine) {
+	_device = device;
+	_readyLine = readyLine;
+	_active = false;
+}
+
+void LinuxFakeSpi::run() {							// events the model missed while nobody looked, in order
+	while (_device->nextEvent() <= hostNow()) {
+		_device->runEvent(_device->nextEvent());
+	}
+}
+
+void LinuxFakeSpi::chipSelect(bool active) {
+	if (_active != active) {
+		_device->select(active);
+		_active = active;
+	}
+}
+
+bool LinuxFakeSpi::message(struct spi_ioc_transfer *xfer, unsigned int n) {
+	run();
+	if (fakeHolder && fakeHolder != this) {			// a message to another chip releases the held CS first
+		fakeHolder->chipSelect(false);
+	}
+	chipSelect(true);
+	for (unsigned int i = 0; i < n; i++) {
+		const uint8_t *tx = (const uint8_t *)(unsigned long)xfer[i].tx_buf;
+		uint8_t *rx = (uint8_t *)(unsigned long)xfer[i].rx_buf;
+		for (unsigned int k = 0; k < xfer[i].len; k++) {
+			uint8_t miso = _device->transfer(tx ? tx[k] : 0x00);	// spidev shifts zeros without a tx buffer
+			if (rx) {
+				rx[k] = miso;
+			}
+		}
+		if (xfer[i].cs_change && i + 1 < n) {		// CS inactive before the next segment
+			chipSelect(false);
+			chipSelect(true);
+		}
+	}
+	if (!xfer[n - 1].cs_change) {
+		chipSelect(false);
+	}
+	fakeHolder = _active ? this : 0;
+	return true;
+}
+
+int LinuxFakeSpi::line() {
+	if (!_readyLine) {
+		return -1;
+	}
+	run();
+	return _active && !_device->dout() ? LOW : HIGH;
+}
@@ -0,0 +1,42 @@
+/*************************************************************************
+* spidev stand-in for the Linux backend
+*
+* Takes the place of a LinuxSpidev without hardware: every message is
+* clocked through a HostDevice model, usually an AD779XSim, segment by
+* segment with the chip select behaviour of the kernel (CS active for the
+* whole message, inactive between segments marked cs_change, kept active
+* after a last segment marked cs_change). The model runs on the real
+* clock: its conversions complete as time passes, whether or not the
+* thread under test is looking. With a ready line, DOUT/~RDY is read
+* from the model as from a GPIO wired to MISO.
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#ifndef LINUX_FAKE_SPI_H
+#define LINUX_FAKE_SPI_H
+
+#include "ArduinoHost.h"
+#include "ArduinoLinux.h"
+
+class LinuxFakeSpi : public LinuxSpi
+{
+	public:
+		LinuxFakeSpi(HostDevice *device, bool readyLine = true);
+		bool watched() { return _readyLine; }
+
+	protected:
+		bool message(struct spi_ioc_transfer *xfer, unsigned int n);
+		int line();
+
+	private:
+		HostDevice *_device;
+		bool _readyLine, _active;
+
+		void run();
+		void chipSelect(bool active);
+};
+
+#endif
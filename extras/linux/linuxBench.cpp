@@ -0,0 +1,233 @@
+/*************************************************************************
+* AD779X Linux backend benchmark
+*
+* Runs AD779XLinux against AD779XSim models behind LinuxFakeSpi, or
+* against real chips on spidev, for a few seconds of real time with a
+* consumer thread draining every chip's AD779XRing, and reports whether
+* the chips were kept up with (conversions missed by the models), what a
+* sample cost in syscalls, SPI messages and segments, and how much of a
+* CPU core the acquisition thread used.
+*
+* Options:
+*   --devices n           chips on the bus, CS pins 10, 11, ... (3)
+*   --channels 1..3       channels passed to Setup() (1)
+*   --rate 1..15          update rate code passed to Config(), 1 is 470Hz (1)
+*   --continuous 0|1      stream in continuous conversion mode, CREAD with one channel (1)
+*   --line 0|1            DOUT/~RDY on a GPIO line; 0 reads the status register instead (1)
+*   --seconds n           real time to run (3)
+*   --priority n          SCHED_FIFO priority of the acquisition thread, 0 for none (0)
+*   --spidev a,b,...      real chips on these spidev devices instead of the models (off)
+*   --gpio chip:offset,...  DOUT/~RDY lines of the --spidev chips (off)
+*
+* This file is free software; you can redistribute it and/or modify
+* it under the terms of either the GNU General Public License version 3
+* published by the Free Software Foundation.
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "ArduinoLinux.h"
+#include "LinuxFakeSpi.h"
+#include "AD779XSim.h"
+#include "AD779XLinux.h"
+#include "AD779X.h"
+
+#define BENCH_CS_PIN		10
+#define BENCH_VREF			2.5
+#define BENCH_RING			128
+
+struct BenchOptions
+{
+	int devices, channels, rate, continuous, line, seconds, priority;
+	const char *spidev, *gpio;
+};
+
+struct BenchConsumer
+{
+	AD779XRing *rings[AD779X_BUS_DEVICES];
+	int devices;
+	volatile bool running;
+	unsigned long long samples[AD779X_BUS_DEVICES];
+	unsigned long maxAge;							// us from a sample being read to the consumer having it
+};
+
+static void parseOptions(int argc, char **argv, BenchOptions &opt) {
+	for (int i = 1; i + 1 < argc; i += 2) {
+		long val = atol(argv[i + 1]);
+		if (!strcmp(argv[i], "--devices")) {
+			opt.devices = val;
+		}
+		else if (!strcmp(argv[i], "--channels")) {
+			opt.channels = val;
+		}
+		else if (!strcmp(argv[i], "--rate")) {
+			opt.rate = val;
+		}
+		else if (!strcmp(argv[i], "--continuous")) {
+			opt.continuous = val;
+		}
+		else if (!strcmp(argv[i], "--line")) {
+			opt.line = val;
+		}
+		else if (!strcmp(argv[i], "--seconds")) {
+			opt.seconds = val;
+		}
+		else if (!strcmp(argv[i], "--priority")) {
+			opt.priority = val;
+		}
+		else if (!strcmp(argv[i], "--spidev")) {
+			opt.spidev = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--gpio")) {
+			opt.gpio = argv[i + 1];
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			exit(1);
+		}
+	}
+}
+
+static bool listItem(const char *list, int index, char *item, size_t size) {	// index-th entry of a comma separated list
+	for (int i = 0; list && i < index; i++) {
+		list = strchr(list, ',');
+		list = list ? list + 1 : 0;
+	}
+	if (!list || !*list) {
+		return false;
+	}
+	size_t n = strcspn(list, ",");
+	n = n < size - 1 ? n : size - 1;
+	memcpy(item, list, n);
+	item[n] = '\0';
+	return true;
+}
+
+static void *consume(void *arg) {					// another thread, as in an application: no locks
+	BenchConsumer &c = *(BenchConsumer *)arg;
+	AD779XSample drained[BENCH_RING];
+	bool last = false;
+	while (!last) {
+		last = !c.running;							// one more pass after the stop
+		for (int d = 0; d < c.devices; d++) {
+			unsigned char n = c.rings[d]->drain(drained, BENCH_RING);
+			unsigned long now = micros();
+			for (unsigned char k = 0; k < n; k++) {
+				c.maxAge = now - drained[k].timestamp > c.maxAge ? now - drained[k].timestamp : c.maxAge;
+			}
+			c.samples[d] += n;
+		}
+		delayMicroseconds(1000);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	BenchOptions opt = {3, 1, 1, 1, 1, 3, 0, 0, 0};
+	parseOptions(argc, argv, opt);
+	if (opt.devices < 1 || opt.devices > AD779X_BUS_DEVICES) {
+		fprintf(stderr, "--devices must be 1..%d\n", AD779X_BUS_DEVICES);
+		return 1;
+	}
+
+	AD779XSim *chip[AD779X_BUS_DEVICES];
+	LinuxSpi *spi[AD779X_BUS_DEVICES];
+	AD779X *adc[AD779X_BUS_DEVICES];
+	AD779XRing *ring[AD779X_BUS_DEVICES];
+	AD779XSample *buffer[AD779X_BUS_DEVICES];
+	AD779XLinux acquisition;
+	for (int d = 0; d < opt.devices; d++) {
+		chip[d] = 0;
+		if (opt.spidev) {
+			char path[128], gpio[128];
+			LinuxSpidev *dev = new LinuxSpidev();
+			char *offset = 0;
+			bool wired = listItem(opt.gpio, d, gpio, sizeof(gpio)) && (offset = strchr(gpio, ':')) != 0;
+			if (wired) {
+				*offset++ = '\0';
+			}
+			if (!listItem(opt.spidev, d, path, sizeof(path)) || !dev->open(path, wired ? gpio : 0, wired ? atoi(offset) : 0)) {
+				fprintf(stderr, "chip %d: cannot open its spidev device or DOUT/~RDY line\n", d);
+				return 1;
+			}
+			spi[d] = dev;
+		}
+		else {
+			chip[d] = new AD779XSim(true);
+			for (int i = 0; i < 3; i++) {
+				chip[d]->setInput(i, BENCH_VREF / 128 * (i + 1) / 4);
+			}
+			spi[d] = new LinuxFakeSpi(chip[d], opt.line);
+		}
+		linuxAttach(spi[d], BENCH_CS_PIN + d);
+		adc[d] = new AD779X(BENCH_VREF);
+		adc[d]->Begin(BENCH_CS_PIN + d);				// polled, the thread wakes up when a result is due
+		adc[d]->Setup(opt.channels, 0, 1, 2);
+		adc[d]->Config(7, 1, opt.rate);
+		if (!adc[d]->Continuous(opt.continuous) && d == 0) {
+			fprintf(stderr, "DOUT/~RDY has no line, streaming without CREAD\n");
+		}
+		buffer[d] = new AD779XSample[BENCH_RING];
+		ring[d] = new AD779XRing(buffer[d], BENCH_RING);
+		adc[d]->attachRing(ring[d]);
+		acquisition.add(adc[d]);
+	}
+
+	BenchConsumer consumer;
+	memset(&consumer, 0, sizeof(consumer));
+	consumer.devices = opt.devices;
+	consumer.running = true;
+	for (int d = 0; d < opt.devices; d++) {
+		consumer.rings[d] = ring[d];
+	}
+	pthread_t consumerThread;
+	pthread_create(&consumerThread, 0, consume, &consumer);
+	linuxClearStats();
+	unsigned long long t0 = hostNow();
+	if (!acquisition.start(opt.priority)) {
+		fprintf(stderr, "cannot start the acquisition thread\n");
+		return 1;
+	}
+	delay(opt.seconds * 1000UL);
+	acquisition.stop();
+	double elapsed = (hostNow() - t0) / 1e6;
+	consumer.running = false;
+	pthread_join(consumerThread, 0);
+
+	const AD779XLinuxStats &a = acquisition.stats();
+	const LinuxBusStats &b = linuxStats();
+	double perSample = a.samples ? 1.0 / a.samples : 0;
+	unsigned long long consumed = 0, conversions = 0, missed = 0, overflows = 0;
+	for (int d = 0; d < opt.devices; d++) {
+		consumed += consumer.samples[d];
+		overflows += ring[d]->overflows();
+		if (chip[d]) {
+			conversions += chip[d]->stats().conversions;
+			missed += chip[d]->stats().missed;
+		}
+	}
+	printf("setup           %d x AD7799 on %s, %d channel(s), rate code %d, %s, DOUT/~RDY %s\n", opt.devices, opt.spidev ? opt.spidev : "LinuxFakeSpi", opt.channels, opt.rate, opt.continuous ? "continuous" : "single conversions", opt.spidev ? (opt.gpio ? "on GPIO" : "as status reads") : (opt.line ? "on GPIO" : "as status reads"));
+	printf("thread          %s, %.1f%% of a core, %.0f ns per sample\n", a.realtime ? "SCHED_FIFO" : "default scheduler", a.cpuNs / 1e7 / elapsed, a.cpuNs * perSample);
+	printf("samples         %llu in %.3f s (%.1f/s, %.1f/s per chip)\n", a.samples, elapsed, a.samples / elapsed, a.samples / elapsed / opt.devices);
+	if (conversions) {
+		printf("models          %llu conversions, %llu missed\n", conversions, missed);
+	}
+	printf("syscalls        %.2f SPI_IOC_MESSAGE + %.2f GPIO reads per sample (%.2f bytes/sample, one per byte would be %.0f/s)\n", b.messages * perSample, b.lineReads * perSample, b.bytes * perSample, b.bytes / elapsed);
+	printf("messages        %.2f segments each, %llu deselects folded in, %llu status probes\n", b.messages ? (double)b.segments / b.messages : 0.0, b.csToggles, b.statusProbes);
+	printf("wake-ups        %.2f per sample, %llu us latest\n", a.wakeups * perSample, a.lateUs);
+	printf("consumer        %llu drained, %llu ring overflows, %lu us oldest sample\n", consumed, overflows, consumer.maxAge);
+	for (int d = 0; d < opt.devices; d++) {
+		printf("chip%d           %llu samples, ch0 raw 0x%06lX  %ld uV\n", d, consumer.samples[d], adc[d]->readRaw(0), adc[d]->readuV(0));
+	}
+	if (conversions && a.samples > conversions) {	// a status probe broke into a CREAD stream
+		fprintf(stderr, "more samples than conversions\n");
+		return 1;
+	}
+	return 0;
+}